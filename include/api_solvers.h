@@ -2,20 +2,90 @@
 #define API_SOLVERS_H
 
 #include <vector>
+#include <memory>
 #include "utils.h"
 #include "clarke_wright.h"
 #include "genetic_algorithm.h"
+#include "decomposition.h"
+#include "solve_job.h"
 
-std::vector<std::vector<std::vector<int>>> completeSolverClarkeWright(
+RoutesProgress completeSolverClarkeWright(
     const double &depot_x,
     const double &depot_y,
     const std::vector<double> &customers_x,
     const std::vector<double> &customers_y,
     const size_t maxPackages,
     const bool exportData,
-    const std::string &fileName = "");
+    const std::string &fileName = "",
+    const size_t numNeighbours = 0,
+    const bool recordHistory = true);
 
-std::vector<std::vector<std::vector<int>>> completeSolverGenetic(
+// Coordinates and an optional (numCustomers + 1) x (numCustomers + 1) row-major distance matrix read in place.
+// Without the matrix, storage picks how the Euclidean distances are kept. reorder solves with the customers
+// renumbered along a space-filling curve, the routes still use the caller's numbers.
+RoutesProgress completeSolverClarkeWright(
+    const double &depot_x,
+    const double &depot_y,
+    const double *customers_x,
+    const double *customers_y,
+    const size_t numCustomers,
+    const double *distances,
+    const size_t maxPackages,
+    const bool exportData,
+    const std::string &fileName = "",
+    const size_t numNeighbours = 0,
+    const bool recordHistory = true,
+    const MatrixStorage storage = MatrixStorage::Dense,
+    const bool reorder = false);
+
+GeneticResult completeSolverGenetic(
+    const double &depot_x,
+    const double &depot_y,
+    const std::vector<double> &customers_x,
+    const std::vector<double> &customers_y,
+    const size_t maxPackages,
+    const size_t populationSize,
+    const size_t generations,
+    const float mutationProb,
+    const bool exportData,
+    const StartingType startingType = StartingType::ClarkeWright,
+    const std::string &fileName = "",
+    const GeneticOptions &options = GeneticOptions());
+
+GeneticResult completeSolverGenetic(
+    const double &depot_x,
+    const double &depot_y,
+    const double *customers_x,
+    const double *customers_y,
+    const size_t numCustomers,
+    const double *distances,
+    const size_t maxPackages,
+    const size_t populationSize,
+    const size_t generations,
+    const float mutationProb,
+    const bool exportData,
+    const StartingType startingType = StartingType::ClarkeWright,
+    const std::string &fileName = "",
+    const GeneticOptions &options = GeneticOptions(),
+    const MatrixStorage storage = MatrixStorage::Dense,
+    const bool reorder = false);
+
+// Large instances solved in geographic sectors, see decompositionSolver. Takes the coordinates and an optional
+// distance matrix like completeSolverClarkeWright.
+RoutesProgress completeSolverDecomposed(
+    const double &depot_x,
+    const double &depot_y,
+    const double *customers_x,
+    const double *customers_y,
+    const size_t numCustomers,
+    const double *distances,
+    const size_t maxPackages,
+    const bool exportData,
+    const std::string &fileName = "",
+    const DecompositionOptions &options = DecompositionOptions(),
+    const MatrixStorage storage = MatrixStorage::Coordinates);
+
+std::unique_ptr<SolveJob> startSolverGenetic(
     const double &depot_x,
     const double &depot_y,
     const std::vector<double> &customers_x,
@@ -26,6 +96,42 @@ std::vector<std::vector<std::vector<int>>> completeSolverGenetic(
     const float mutationProb,
     const bool exportData,
     const StartingType startingType = StartingType::ClarkeWright,
-    const std::string &fileName = "");
+    const std::string &fileName = "",
+    const GeneticOptions &options = GeneticOptions(),
+    const std::vector<double> &distances = {});
+
+// One problem of a batch: a depot, its customers and the vehicle capacity.
+struct BatchInstance
+{
+    double depot_x = 0.0;
+    double depot_y = 0.0;
+    std::vector<double> customers_x;
+    std::vector<double> customers_y;
+    size_t maxPackages = 0;
+};
+
+// The result of every instance in input order, and how long the whole batch took.
+template <typename Result>
+struct BatchResult
+{
+    std::vector<Result> results;
+    double seconds = 0.0;
+    double instancesPerSecond = 0.0;
+};
+
+BatchResult<RoutesProgress> completeSolverClarkeWrightBatch(
+    const std::vector<BatchInstance> &instances,
+    const size_t numNeighbours = 0,
+    const bool recordHistory = false,
+    const size_t largeInstanceSize = 1000);
+
+BatchResult<GeneticResult> completeSolverGeneticBatch(
+    const std::vector<BatchInstance> &instances,
+    const size_t populationSize,
+    const size_t generations,
+    const float mutationProb,
+    const StartingType startingType = StartingType::ClarkeWright,
+    const GeneticOptions &options = GeneticOptions(),
+    const size_t largeInstanceSize = 1000);
 
 #endif
\ No newline at end of file
@@ -2,12 +2,34 @@
 #define CLARKE_WRIGHT_H
 
 #include <vector>
+#include <tuple>
+#include <cstddef>
+#include <cstdint>
+#include "routes_progress.h"
 struct Matrix;
 
-std::pair<std::vector<std::vector<int>>, std::vector<std::vector<std::vector<int>>>>
-clarkeWrightSolver(const Matrix &distMatrix, const size_t maxPackages);
+// One entry of the savings list: joining customers i and j into one route saves saving. Packed into 12 bytes, a float
+// is precise enough to order the savings.
+struct Saving
+{
+    float saving;
+    std::uint32_t i;
+    std::uint32_t j;
+};
 
-std::pair<std::vector<std::vector<int>>, std::vector<std::vector<std::vector<int>>>>
-processSavings(const std::vector<std::tuple<int, int, double>> &savings, const size_t numCustomers, const size_t maxPackages);
+std::pair<std::vector<std::vector<int>>, RoutesProgress>
+clarkeWrightSolver(const Matrix &distMatrix, const size_t maxPackages, const size_t numNeighbours = 0,
+                   const bool recordHistory = true);
+
+std::vector<Saving> getSavings(const Matrix &distMatrix, const size_t numNeighbours = 0);
+void sortSavings(std::vector<Saving> &savings);
+
+std::pair<std::vector<std::vector<int>>, RoutesProgress>
+processSavings(const std::vector<Saving> &savings, const size_t numCustomers, const size_t maxPackages,
+               const bool recordHistory = true);
+
+std::pair<std::vector<std::vector<int>>, RoutesProgress>
+processSavings(const std::vector<std::tuple<int, int, double>> &savings, const size_t numCustomers, const size_t maxPackages,
+               const bool recordHistory = true);
 
 #endif
\ No newline at end of file
@@ -2,13 +2,15 @@
 #define CREATE_CHILD_H
 
 #include "genetic_algo_utils.h"
+#include "local_search.h"
+#include "rng.h"
 #include <vector>
 struct Matrix;
 
-Individual createChild(const std::vector<Individual> &parents, const size_t maxPackages, const float mutationProb, const Matrix &distMatrix);
-Individual routeCrossover(const Individual &parentA, const Individual &parentB, const size_t maxPackages, const Matrix &distMatrix);
-void mutation(Individual &child, const float mutationProbability, const size_t maxPackages);
-void moveRandomElement(Individual &child, const size_t maxPackages);
+void createChild(const Individual &first, const Individual &second, Individual &child, const size_t maxPackages, const float mutationProb, const Matrix &distMatrix, Rng &rng, const LocalSearchType localSearch = LocalSearchType::IntraRoute);
+void routeCrossover(const Individual &parentA, const Individual &parentB, const size_t maxPackages, const Matrix &distMatrix, Individual &child);
+void mutation(Individual &child, const float mutationProbability, const size_t maxPackages, const Matrix &distMatrix, Rng &rng);
+void moveRandomElement(Individual &child, const size_t maxPackages, const Matrix &distMatrix, Rng &rng);
 void twoOptSwap(Individual &child, const Matrix &distMatrix);
 
 #endif
\ No newline at end of file
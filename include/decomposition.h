@@ -0,0 +1,45 @@
+#ifndef DECOMPOSITION_H
+#define DECOMPOSITION_H
+
+#include "utils.h"
+#include "genetic_algorithm.h"
+#include "routes_progress.h"
+#include <vector>
+#include <cstddef>
+
+// The solver decompositionSolver runs on every sector and window.
+enum class SubSolver
+{
+    ClarkeWright,
+    Genetic,
+    COUNT
+};
+
+// Settings for decompositionSolver, see there for how they are used.
+struct DecompositionOptions
+{
+    size_t partitionSize = 1000; // Customers per sector
+    size_t windowRoutes = 8;     // Routes in each re-solved window, 0 turns the windows off
+    size_t windowPasses = 1;     // Times every window boundary is re-solved
+    SubSolver subSolver = SubSolver::ClarkeWright;
+    bool recordHistory = true; // false keeps only the final routes
+
+    // Clarke-Wright sub-solves
+    size_t numNeighbours = 0;
+
+    // Genetic sub-solves. The limits of options apply to every sub-solve on its own, its seed is varied per
+    // sub-problem and its monitor is not used.
+    size_t populationSize = 20;
+    size_t generations = 50;
+    float mutationProb = 0.5f;
+    StartingType startingType = StartingType::ClarkeWright;
+    GeneticOptions genetic;
+};
+
+std::pair<std::vector<std::vector<int>>, RoutesProgress>
+decompositionSolver(const Matrix &distMatrix, const std::vector<Point> &locations, const size_t maxPackages,
+                    const DecompositionOptions &options = DecompositionOptions());
+
+std::vector<std::vector<int>> sweepSectors(const std::vector<Point> &locations, const size_t partitionSize);
+
+#endif
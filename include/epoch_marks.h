@@ -0,0 +1,46 @@
+#ifndef EPOCH_MARKS_H
+#define EPOCH_MARKS_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+/* Set of dense ids, e.g. the customers a child already holds, that is emptied in O(1)
+    - An id is marked when its stamp equals the current epoch, so clear() only moves on to the next epoch instead of
+      writing every stamp. The stamps are only wiped when the epoch wraps around, once every 2^32 clears.
+    - Meant to live as long as its thread (thread_local), so one set serves every child without allocating.
+*/
+class EpochMarks
+{
+public:
+    // Removes every mark and makes room for the ids below size.
+    void clear(const size_t size)
+    {
+        if (stamps.size() < size)
+        {
+            stamps.resize(size, 0);
+        }
+        if (++epoch == 0)
+        {
+            std::fill(stamps.begin(), stamps.end(), 0);
+            epoch = 1;
+        }
+    }
+
+    bool marked(const size_t id) const
+    {
+        return stamps[id] == epoch;
+    }
+
+    void mark(const size_t id)
+    {
+        stamps[id] = epoch;
+    }
+
+private:
+    std::vector<std::uint32_t> stamps;
+    std::uint32_t epoch = 0;
+};
+
+#endif
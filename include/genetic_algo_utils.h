@@ -3,12 +3,18 @@
 
 #include <vector>
 #include <ostream>
+#include <array>
+#include <cstdint>
+#include "rng.h"
 struct Matrix;
 
 // Struct representing a set of routes with a fitness level (total distance)
+// lengths holds the distance of every route, or is empty when they are not known. The operators of createChild keep it
+// up to date, so a child only measures the routes that changed (see updateDistance).
 struct Individual
 {
     std::vector<std::vector<int>> routes;
+    std::vector<double> lengths;
     double total_distance;
 
     Individual(const std::vector<std::vector<int>> &r = {}, double d = 0.0)
@@ -16,14 +22,32 @@ struct Individual
 };
 std::ostream &operator<<(std::ostream &os, const Individual &individual);
 
-std::vector<std::vector<int>> getRandomRoutes(const size_t distMatrixSize, const size_t maxPackages);
-std::vector<Individual> getRandomPopulation(const Matrix &distMatrix, const size_t populationSize, const size_t maxPackages);
+// Per-thread pool of route vectors, so routes keep their capacity from one child to the next instead of being freed.
+std::vector<int> takeRoute(const size_t capacity);
+void releaseRoute(std::vector<int> &route);
+void releaseRoutes(std::vector<std::vector<int>> &routes, const size_t first);
+
+std::vector<std::vector<int>> getRandomRoutes(const size_t distMatrixSize, const size_t maxPackages, Rng &rng);
+std::vector<Individual> getRandomPopulation(const Matrix &distMatrix, const size_t populationSize, const size_t maxPackages, const std::uint64_t seed);
 double routeDistance(const std::vector<int> &route, const Matrix &distMatrix);
+
+// routeDistance for loops that already hold the distance reader of withDistances.
+template <typename Distances>
+double routeDistanceWith(const std::vector<int> &route, const Distances &d)
+{
+    double distance = 0.0;
+    for (size_t i = 0; i < route.size() - 1; ++i)
+    {
+        distance += d(route[i], route[i + 1]);
+    }
+    return distance;
+}
 double routeDistancePerLocation(const std::vector<int> &route, const Matrix &distMatrix);
 double distanceOfRoutes(const std::vector<std::vector<int>> &routes, const Matrix &distMatrix);
-std::vector<Individual> selectParents(const std::vector<Individual> &population, const size_t numOfParentCandidates, const size_t numOfParents);
+std::array<size_t, 2> selectParents(const std::vector<double> &fitness, const size_t numOfParentCandidates, Rng &rng);
 void updateDistance(Individual &child, const Matrix &distMatrix);
-Individual bestFromPopulation(const std::vector<Individual> &population);
+void updateTotalDistance(Individual &child);
+size_t bestInPopulation(const std::vector<Individual> &population);
 Individual createNearestNeighbourIndividual(const Matrix &distMatrix, const size_t maxPackages);
 Individual createCalrkeWrightIndividual(const Matrix &distMatrix, const size_t maxPackages);
 
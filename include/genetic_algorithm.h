@@ -2,7 +2,12 @@
 #define GENETIC_ALGORITHM_H
 
 #include "utils.h"
+#include "local_search.h"
+#include "routes_progress.h"
 #include <vector>
+#include <cstdint>
+#include <atomic>
+#include <limits>
 
 // Different starting types for geneticSolver. Mixed creates a population with one third coming from the other types.
 enum class StartingType
@@ -14,13 +19,87 @@ enum class StartingType
     COUNT
 };
 
-std::vector<std::vector<std::vector<int>>>
+// Where the migrants of an island go: Ring sends them to the next island, Random to a random other island every time.
+enum class MigrationTopology
+{
+    Ring,
+    Random,
+    COUNT
+};
+
+// How geneticSolver stores an individual. Routes keeps its routes and combines them with routeCrossover. GiantTour keeps
+// one permutation of all customers in a flat array, combines them with order crossover and splits them into routes.
+enum class Representation
+{
+    Routes,
+    GiantTour,
+    COUNT
+};
+
+// Island model for geneticSolver. With count > 1 there are count populations of populationSize individuals that evolve
+// independently, one island per thread. Every migrationInterval generations each island sends copies of its migrants
+// best individuals to another island, where they replace the worst individuals.
+struct IslandOptions
+{
+    size_t count = 1;
+    size_t migrationInterval = 10;
+    size_t migrants = 2;
+    MigrationTopology topology = MigrationTopology::Ring;
+};
+
+// Lets another thread follow a running geneticSolver and stop it, see GeneticOptions::monitor.
+struct SolveMonitor
+{
+    std::atomic<bool> cancelled{false}; // Set to stop the solver after its current generation
+    std::atomic<size_t> generation{0};  // Generations finished so far
+    std::atomic<double> bestDistance{std::numeric_limits<double>::infinity()};
+};
+
+// Optional settings for geneticSolver, the defaults are what the solver uses when none are given.
+struct GeneticOptions
+{
+    LocalSearchType localSearch = LocalSearchType::IntraRoute;
+    bool recordHistory = true; // false keeps only the best routes at the end instead of every improvement
+    std::uint64_t seed = 0;    // Runs with the same seed give the same routes, whatever the number of threads
+    IslandOptions islands;
+    Representation representation = Representation::Routes;
+
+    // Stopping early, checked between generations (between migrations with islands). 0 turns a limit off.
+    double timeLimit = 0.0;      // Seconds of wall-clock time
+    size_t stallGenerations = 0; // Generations in a row without a shorter best total distance
+    double targetDistance = 0.0; // Stop once the best total distance is at most this
+
+    // Updated after every generation (every migration interval with islands) and checked for cancelled like the
+    // time limit. Must outlive the solve.
+    SolveMonitor *monitor = nullptr;
+};
+
+// Why geneticSolver stopped.
+enum class StopReason
+{
+    MaxGenerations,
+    TimeLimit,
+    Stalled,
+    TargetReached,
+    Cancelled
+};
+
+// The best routes found by geneticSolver, why it stopped and how many generations it ran.
+struct GeneticResult
+{
+    RoutesProgress progress;
+    StopReason stopReason;
+    size_t generations;
+};
+
+GeneticResult
 geneticSolver(
     const Matrix &distMatrix,
     const size_t maxPackages,
     const size_t populationSize,
     const size_t maxGenerations,
     const float mutationProb,
-    const StartingType startingType = StartingType::ClarkeWright);
+    const StartingType startingType = StartingType::ClarkeWright,
+    const GeneticOptions &options = GeneticOptions());
 
 #endif
\ No newline at end of file
@@ -0,0 +1,19 @@
+#ifndef GIANT_TOUR_H
+#define GIANT_TOUR_H
+
+#include "local_search.h"
+#include "rng.h"
+#include <vector>
+#include <cstddef>
+struct Matrix;
+
+// Giant tour representation for geneticSolver (Representation::GiantTour): an individual is one permutation of the
+// customers 1..numCustomers without depots, and splitTour cuts it into the best routes in that order.
+void giantTour(const std::vector<std::vector<int>> &routes, int *tour);
+double splitTour(const int *tour, const size_t numCustomers, const size_t maxPackages, const Matrix &distMatrix);
+double splitTour(const int *tour, const size_t numCustomers, const size_t maxPackages, const Matrix &distMatrix, std::vector<std::vector<int>> &routes);
+void orderCrossover(const int *parentA, const int *parentB, const size_t numCustomers, int *child, Rng &rng);
+double createTourChild(const int *first, const double firstDistance, const int *second, const double secondDistance, int *child, const size_t numCustomers,
+                       const size_t maxPackages, const float mutationProb, const Matrix &distMatrix, Rng &rng, const LocalSearchType localSearch);
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef HUGE_PAGE_ALLOCATOR_H
+#define HUGE_PAGE_ALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+/* Allocator for the distance matrix storage
+    - Allocations of at least one huge page (2 MB) are aligned to it and rounded up to whole huge pages, and on Linux
+      they are marked for transparent huge pages, so reading a large matrix needs far fewer TLB entries.
+    - Smaller allocations use plain operator new.
+    - resize() leaves the new elements uninitialised, the matrix builders write every element anyway and the first
+      write then happens on the thread that fills that part of the matrix.
+*/
+template <typename T>
+struct HugePageAllocator
+{
+    using value_type = T;
+    static constexpr size_t hugePageSize = 2 * 1024 * 1024;
+
+    HugePageAllocator() = default;
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U> &) {}
+
+    T *allocate(const size_t count)
+    {
+        const size_t bytes = count * sizeof(T);
+        if (bytes < hugePageSize)
+        {
+            return static_cast<T *>(::operator new(bytes));
+        }
+        const size_t rounded = (bytes + hugePageSize - 1) / hugePageSize * hugePageSize;
+        void *memory = ::operator new(rounded, std::align_val_t(hugePageSize));
+#ifdef __linux__
+        madvise(memory, rounded, MADV_HUGEPAGE); // Only a hint, the memory works the same without huge pages
+#endif
+        return static_cast<T *>(memory);
+    }
+
+    template <typename U>
+    void construct(U *pointer)
+    {
+        ::new (static_cast<void *>(pointer)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U *pointer, Args &&...args)
+    {
+        ::new (static_cast<void *>(pointer)) U(std::forward<Args>(args)...);
+    }
+
+    void deallocate(T *pointer, const size_t count)
+    {
+        if (count * sizeof(T) < hugePageSize)
+        {
+            ::operator delete(pointer);
+        }
+        else
+        {
+            ::operator delete(pointer, std::align_val_t(hugePageSize));
+        }
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const HugePageAllocator<T> &, const HugePageAllocator<U> &)
+{
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const HugePageAllocator<T> &, const HugePageAllocator<U> &)
+{
+    return false;
+}
+
+#endif
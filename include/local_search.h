@@ -0,0 +1,26 @@
+#ifndef LOCAL_SEARCH_H
+#define LOCAL_SEARCH_H
+
+#include <vector>
+#include <cstddef>
+struct Matrix;
+struct Individual;
+
+// Local search applied to every child in createChild.
+// TwoOptSwap is the original copy-and-rescore 2-opt, kept so the engines can be compared on the same input.
+// IntraInterRoute runs the IntraRoute moves and also moves locations between routes.
+enum class LocalSearchType
+{
+    TwoOptSwap,
+    IntraRoute,
+    IntraInterRoute,
+    COUNT
+};
+
+double improveRoute(std::vector<int> &route, const Matrix &distMatrix, std::vector<unsigned char> &dontLook);
+double improveRoutes(std::vector<std::vector<int>> &routes, const Matrix &distMatrix, const size_t maxPackages, std::vector<unsigned char> &dontLook,
+                     std::vector<double> *lengths = nullptr);
+void intraRouteSearch(Individual &child, const Matrix &distMatrix);
+void interRouteSearch(Individual &child, const Matrix &distMatrix, const size_t maxPackages);
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+#include <cstddef>
+
+/* Random number generator for the genetic solver
+    - xoshiro256** seeded through splitmix64: small state, fast, and the same numbers on every platform, which the
+      standard library distributions do not promise.
+    - Rng(seed, stream, substream) gives an independent generator for every key, e.g. (seed, generation, family), so
+      each child of the genetic solver draws its own numbers and the result does not depend on which thread made it.
+    - Works as a UniformRandomBitGenerator, but shuffles use uniformInt instead of std::shuffle, whose algorithm
+      differs between standard libraries.
+*/
+class Rng
+{
+public:
+    using result_type = std::uint64_t;
+
+    explicit Rng(const std::uint64_t seed = 0, const std::uint64_t stream = 0, const std::uint64_t substream = 0)
+    {
+        std::uint64_t key = splitMix(seed);
+        key = splitMix(key ^ stream);
+        key = splitMix(key ^ substream);
+        for (auto &word : state)
+        {
+            word = splitMix(key);
+            key += 0x9E3779B97F4A7C15ull;
+        }
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    result_type operator()()
+    {
+        const std::uint64_t result = rotl(state[1] * 5, 7) * 9;
+        const std::uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
+    // Uniform integer in [0, bound), bound must be positive. Multiply-shift with rejection, so it has no modulo bias.
+    std::uint32_t uniformInt(const std::uint32_t bound)
+    {
+        std::uint64_t product = static_cast<std::uint64_t>(static_cast<std::uint32_t>((*this)() >> 32)) * bound;
+        std::uint32_t low = static_cast<std::uint32_t>(product);
+        if (low < bound)
+        {
+            const std::uint32_t threshold = -bound % bound;
+            while (low < threshold)
+            {
+                product = static_cast<std::uint64_t>(static_cast<std::uint32_t>((*this)() >> 32)) * bound;
+                low = static_cast<std::uint32_t>(product);
+            }
+        }
+        return static_cast<std::uint32_t>(product >> 32);
+    }
+
+    // Uniform integer in [min, max], both included.
+    int uniformInt(const int min, const int max)
+    {
+        return min + static_cast<int>(uniformInt(static_cast<std::uint32_t>(max - min) + 1));
+    }
+
+    // Uniform float in [0, 1).
+    float uniformFloat()
+    {
+        return static_cast<float>((*this)() >> 40) * (1.0f / 16777216.0f);
+    }
+
+private:
+    static std::uint64_t rotl(const std::uint64_t x, const int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    static std::uint64_t splitMix(std::uint64_t x)
+    {
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    std::uint64_t state[4];
+};
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef ROUTES_PROGRESS_H
+#define ROUTES_PROGRESS_H
+
+#include <vector>
+#include <cstddef>
+
+// The ways one step of a solver can change the routes. Every recorded step is one frame of the progress.
+enum class ProgressStep : unsigned char
+{
+    Keyframe,   // All routes are replaced, a is the number of the keyframe
+    NewRoute,   // A new route with customer a, followed by customer b unless b is 0
+    AddToFront, // Customer b is added to the front of route a
+    AddToBack,  // Customer b is added to the back of route a
+    Join        // Route b is joined onto route a and removed
+};
+
+// One recorded step, for Join joinedFirst puts route b in front of route a and reverseJoined reverses it first.
+struct ProgressEvent
+{
+    ProgressStep step;
+    bool joinedFirst;
+    bool reverseJoined;
+    int a;
+    int b;
+};
+
+// Frames as flat arrays, the CSR layout: route r is customers[routeOffsets[r], routeOffsets[r + 1]) and frame f is
+// routes [frameOffsets[f], frameOffsets[f + 1]). Routes start and end with the depot like in frame().
+struct FlatFrames
+{
+    std::vector<int> customers;
+    std::vector<size_t> routeOffsets{0};
+    std::vector<size_t> frameOffsets{0};
+};
+
+/* Compact record of how a solver's routes changed.
+    - Stores keyframes (all routes) with small events in between instead of a copy of all routes per step,
+      so Clarke-Wright's history is O(n) in total instead of O(n^2).
+    - Routes are numbered in the order they were created since the last keyframe. A frame lists the routes that
+      exist at that point in that order, each starting and ending with the depot.
+    - With recordHistory false only the last keyframe is kept, solvers use it to store just their final routes.
+    - Frames are rebuilt on demand with ProgressCursor, frame() replays from the closest keyframe before it.
+*/
+class RoutesProgress
+{
+public:
+    explicit RoutesProgress(const bool recordHistory = true);
+
+    bool recordsHistory() const;
+    size_t size() const;
+    bool empty() const;
+
+    void keyframe(const std::vector<std::vector<int>> &routes);
+    void newRoute(const int first, const int second = 0);
+    void addToFront(const int route, const int customer);
+    void addToBack(const int route, const int customer);
+    void join(const int route, const int joinedRoute, const bool joinedFirst, const bool reverseJoined);
+    void renumber(const std::vector<int> &ids);
+
+    std::vector<std::vector<int>> frame(const size_t index) const;
+    std::vector<std::vector<int>> back() const;
+    std::vector<std::vector<std::vector<int>>> frames() const;
+    FlatFrames flatFrames() const;
+    FlatFrames flatFrames(const size_t first, const size_t last) const;
+
+private:
+    friend class ProgressCursor;
+
+    bool recordHistory;
+    std::vector<ProgressEvent> events;
+    std::vector<size_t> keyframeEvents;  // Event index of each keyframe
+    std::vector<size_t> keyframeRoutes;  // Keyframe k owns routes [keyframeRoutes[k], keyframeRoutes[k + 1])
+    std::vector<size_t> routeOffsets;    // Route r owns keyframeCustomers[routeOffsets[r], routeOffsets[r + 1])
+    std::vector<int> keyframeCustomers;
+};
+
+// Replays a RoutesProgress one frame at a time. It starts before the first frame, next() moves to the following one.
+class ProgressCursor
+{
+public:
+    explicit ProgressCursor(const RoutesProgress &progress);
+
+    bool next();
+    void seek(const size_t index);
+    std::vector<std::vector<int>> routes() const;
+    void appendRoutes(std::vector<int> &customers, std::vector<size_t> &routeOffsets) const;
+
+private:
+    void apply(const ProgressEvent &event);
+
+    const RoutesProgress *progress;
+    size_t nextEvent;
+    std::vector<std::vector<int>> state;
+    std::vector<bool> alive;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef SOLVE_JOB_H
+#define SOLVE_JOB_H
+
+#include "genetic_algorithm.h"
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+/* A solve running on its own native thread
+    - The solve function is started as soon as the job is made, it gets the job's monitor to report progress to and
+      check for cancellation (pass it on as GeneticOptions::monitor).
+    - generation() and bestDistance() can be polled while it runs. cancel() asks the solver to stop after its current
+      generation, the result then has StopReason::Cancelled.
+    - result() waits for the solve to finish and rethrows anything the solve threw.
+    - Destroying a job that is still running cancels it and waits for its thread.
+*/
+class SolveJob
+{
+public:
+    explicit SolveJob(std::function<GeneticResult(SolveMonitor &)> solve);
+    ~SolveJob();
+
+    SolveJob(const SolveJob &) = delete;
+    SolveJob &operator=(const SolveJob &) = delete;
+
+    void cancel();
+    bool done() const;
+    void wait() const;
+    bool waitFor(const double seconds) const;
+
+    size_t generation() const;
+    double bestDistance() const;
+    const GeneticResult &result() const;
+
+private:
+    SolveMonitor monitor;
+    mutable std::mutex mutex;
+    mutable std::condition_variable finished;
+    bool isDone = false;
+    GeneticResult outcome{RoutesProgress(), StopReason::MaxGenerations, 0};
+    std::exception_ptr error;
+    std::thread worker; // Last, so everything the thread uses exists before it starts
+};
+
+#endif
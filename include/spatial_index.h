@@ -0,0 +1,43 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include "utils.h"
+#include <vector>
+#include <cstddef>
+
+// Static 2-d tree over a set of locations, stored implicitly: the node of the range [lo, hi) is at (lo + hi) / 2.
+// points and ids are reordered copies of the input, axis holds the split direction (0 = x, 1 = y) of each node.
+struct KdTree
+{
+    std::vector<Point> points;
+    std::vector<int> ids;
+    std::vector<unsigned char> axis;
+};
+
+/* A KdTree whose points can be removed one at a time, e.g. to visit every location once
+    - nearest() returns the closest point still in the tree, remove() takes a point out. Both follow one path down
+      the tree plus the branches that can still hold a closer point, O(log n) for spread out points.
+    - Every node counts the points left in its subtree, so emptied parts of the tree are skipped.
+*/
+class RemovableKdTree
+{
+public:
+    explicit RemovableKdTree(KdTree tree);
+
+    bool empty() const;
+    void remove(const int id);
+    int nearest(const Matrix &distMatrix, const int from) const;
+
+private:
+    KdTree tree;
+    std::vector<int> aliveBelow; // Points left in the subtree of each node
+    std::vector<char> alive;
+    std::vector<size_t> positionOf; // Node of each id
+};
+
+KdTree buildKdTree(const std::vector<Point> &points, const std::vector<int> &ids);
+void kNearest(const KdTree &tree, const Point &query, const size_t k, const int exclude, std::vector<int> &result);
+std::vector<int> getNeighbourLists(const Matrix &distMatrix, const size_t numNeighbours);
+std::vector<int> hilbertOrder(const std::vector<Point> &points);
+
+#endif
@@ -3,6 +3,13 @@
 
 #include <vector>
 #include <string>
+#include <cmath>
+#include <limits>
+#include <cstdint>
+#include <algorithm>
+#include "huge_page_allocator.h"
+
+class RoutesProgress;
 
 // Struct representing the position of a point that would be a location.
 struct Point
@@ -12,16 +19,153 @@ struct Point
 };
 std::ostream &operator<<(std::ostream &os, const Point &point);
 
-// Struct for distance matrix
+/* How a Matrix holds its distances
+    - Dense stores every distance as a double.
+    - Coordinates only stores the locations and computes Euclidean distances when they are read, O(n) memory.
+    - PackedTriangular stores each pair once as a double in the lower triangle, the matrix has to be symmetric (half
+      of Dense).
+    - Float32 stores every distance as a float (half of Dense), about 7 significant digits.
+    - FixedPoint stores every distance as a 16-bit multiple of fixedScale (a quarter of Dense), which is the longest
+      distance / 65534, so each distance is off by at most fixedScale / 2.
+*/
+enum class MatrixStorage
+{
+    Dense,
+    Coordinates,
+    PackedTriangular,
+    Float32,
+    FixedPoint,
+    COUNT
+};
+
+// Struct for distance matrix, read with distMatrix(i, j) whatever the storage.
+// locations holds the coordinates the matrix was built from (depot first), it is empty if they are unknown.
+// rows can also point into memory the Matrix does not own, data is then empty (see getDistanceMatrixView).
+// data holds the Dense rows or the PackedTriangular lower triangle, where rows[i] points at the i distances from i to
+// the locations before it. Coordinates storage keeps the locations as structure of arrays in xs and ys.
 struct Matrix
 {
-    std::vector<double> data;
+    std::vector<double, HugePageAllocator<double>> data;
     std::vector<double *> rows;
+    std::vector<Point> locations;
+    MatrixStorage storage = MatrixStorage::Dense;
+    std::vector<double> xs;
+    std::vector<double> ys;
+    std::vector<float, HugePageAllocator<float>> floatData;
+    std::vector<std::uint16_t, HugePageAllocator<std::uint16_t>> fixedData;
+    double fixedScale = 1.0;
+
+    size_t size() const
+    {
+        return storage == MatrixStorage::Dense ? rows.size() : locations.size();
+    }
+
+    double operator()(const size_t i, const size_t j) const
+    {
+        return storage == MatrixStorage::Dense ? rows[i][j] : computeDistance(i, j);
+    }
+
+    double computeDistance(const size_t i, const size_t j) const;
+    const double *row(const size_t i, const size_t first, const size_t last, double *buffer) const;
+};
+
+// Reads the distances of a Dense matrix.
+struct DenseDistances
+{
+    double *const *rows;
+
+    double operator()(const size_t i, const size_t j) const
+    {
+        return rows[i][j];
+    }
+};
+
+// Computes the distances of a Coordinates matrix. A location is infinitely far from itself like in the dense matrix.
+struct CoordinateDistances
+{
+    const double *xs;
+    const double *ys;
+
+    double operator()(const size_t i, const size_t j) const
+    {
+        if (i == j)
+        {
+            return std::numeric_limits<double>::infinity();
+        }
+        const double x_dist = xs[j] - xs[i];
+        const double y_dist = ys[j] - ys[i];
+        return std::sqrt((x_dist * x_dist) + (y_dist * y_dist));
+    }
 };
 
+// Reads a PackedTriangular matrix, rows[i] holds the distances from i to the locations before it.
+struct PackedDistances
+{
+    double *const *rows;
+
+    double operator()(const size_t i, const size_t j) const
+    {
+        if (i == j)
+        {
+            return std::numeric_limits<double>::infinity();
+        }
+        // min and max instead of a swap, the order of i and j is random so a branch would often be mispredicted
+        return rows[std::max(i, j)][std::min(i, j)];
+    }
+};
+
+// Reads a Float32 matrix.
+struct Float32Distances
+{
+    const float *data;
+    size_t n;
+
+    double operator()(const size_t i, const size_t j) const
+    {
+        return data[i * n + j];
+    }
+};
+
+// Reads a FixedPoint matrix, the largest value stands for an infinite distance.
+struct FixedPointDistances
+{
+    const std::uint16_t *data;
+    size_t n;
+    double scale;
+
+    double operator()(const size_t i, const size_t j) const
+    {
+        const std::uint16_t value = data[i * n + j];
+        return value == UINT16_MAX ? std::numeric_limits<double>::infinity() : value * scale;
+    }
+};
+
+// Calls function with the reader for the matrix's storage, so hot loops check the storage once instead of on every
+// distance they read. All calls must return the same type.
+template <typename Function>
+auto withDistances(const Matrix &distMatrix, Function &&function)
+{
+    const size_t n = distMatrix.size();
+    switch (distMatrix.storage)
+    {
+    case MatrixStorage::Coordinates:
+        return function(CoordinateDistances{distMatrix.xs.data(), distMatrix.ys.data()});
+    case MatrixStorage::PackedTriangular:
+        return function(PackedDistances{distMatrix.rows.data()});
+    case MatrixStorage::Float32:
+        return function(Float32Distances{distMatrix.floatData.data(), n});
+    case MatrixStorage::FixedPoint:
+        return function(FixedPointDistances{distMatrix.fixedData.data(), n, distMatrix.fixedScale});
+    default:
+        return function(DenseDistances{distMatrix.rows.data()});
+    }
+}
+
 std::vector<Point> getRandomPoints(const size_t count, const double minDistance, const double maxDistance);
-Matrix getDistanceMatrix(const std::vector<Point> &depots, const std::vector<Point> &customers);
+std::vector<Point> getRandomPoints(const size_t count, const double minDistance, const double maxDistance, const unsigned int seed);
+Matrix getDistanceMatrix(const std::vector<Point> &depots, const std::vector<Point> &customers, const MatrixStorage storage = MatrixStorage::Dense);
+Matrix getDistanceMatrixView(const double *distances, const size_t size);
 void exportMatrixToCSV(const std::vector<std::vector<int>> &routes, const std::vector<Point> &locations, const std::string &filename);
-void exportRoutesProgressToCSV(const std::vector<std::vector<std::vector<int>>> &routesProgress, const std::vector<Point> &locations, const std::string &filename);
+void exportRoutesProgressToCSV(const RoutesProgress &routesProgress, const std::vector<Point> &locations, const std::string &filename);
 
 #endif
\ No newline at end of file
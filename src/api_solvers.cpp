@@ -1,51 +1,253 @@
+#include "api_solvers.h"
 #include "utils.h"
 #include "clarke_wright.h"
 #include "genetic_algorithm.h"
+#include "decomposition.h"
+#include "routes_progress.h"
+#include "solve_job.h"
+#include "spatial_index.h"
 #include <vector>
+#include <memory>
 #include <stdexcept>
+#include <algorithm>
+#include <numeric>
+#include <exception>
+#include <chrono>
 
 // Functions to be accessed in Python
 
-std::vector<std::vector<std::vector<int>>> completeSolverClarkeWright(
+// Depot first, then the customers, in the order the solvers number them.
+static std::vector<Point> getLocations(
+    const double depot_x,
+    const double depot_y,
+    const double *customers_x,
+    const double *customers_y,
+    const size_t numCustomers)
+{
+    std::vector<Point> locations;
+    locations.reserve(numCustomers + 1);
+    locations.push_back({depot_x, depot_y});
+    for (size_t i = 0; i < numCustomers; ++i)
+    {
+        locations.push_back({customers_x[i], customers_y[i]});
+    }
+    return locations;
+}
+
+// Euclidean distances between the locations in the given storage, or a view of distances when they are given.
+static Matrix getApiMatrix(const std::vector<Point> &locations, const double *distances, const MatrixStorage storage)
+{
+    if (distances != nullptr)
+    {
+        return getDistanceMatrixView(distances, locations.size());
+    }
+    std::vector<Point> depots(locations.begin(), locations.begin() + 1);
+    std::vector<Point> customers(locations.begin() + 1, locations.end());
+    return getDistanceMatrix(depots, customers, storage);
+}
+
+// The locations and distances of a solve with the customers renumbered, ids[k] is the caller's number of location k.
+struct SpatialOrder
+{
+    std::vector<int> ids;
+    std::vector<Point> locations;
+    std::vector<double> distances;
+};
+
+/* Renumbers the customers along a Hilbert curve, so customers that are close together get close numbers
+    - The solvers then read distances from nearby rows of the matrix and stay in cache on large instances.
+    - The depot stays location 0. Given distances are copied into the new order, so they are no longer read in place.
+*/
+static SpatialOrder getSpatialOrder(const std::vector<Point> &locations, const double *distances)
+{
+    SpatialOrder order;
+    std::vector<int> customerOrder = hilbertOrder(std::vector<Point>(locations.begin() + 1, locations.end()));
+    order.ids.reserve(locations.size());
+    order.ids.push_back(0);
+    for (int customer : customerOrder)
+    {
+        order.ids.push_back(customer + 1);
+    }
+
+    order.locations.reserve(locations.size());
+    for (int id : order.ids)
+    {
+        order.locations.push_back(locations[id]);
+    }
+
+    if (distances != nullptr)
+    {
+        const size_t size = locations.size();
+        order.distances.resize(size * size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            const double *row = distances + order.ids[i] * size;
+            for (size_t j = 0; j < size; ++j)
+            {
+                order.distances[i * size + j] = row[order.ids[j]];
+            }
+        }
+    }
+    return order;
+}
+
+// Takes the coordinates as arrays that are read in place, e.g. NumPy arrays. distances is an optional
+// (numCustomers + 1) x (numCustomers + 1) row-major matrix that is used instead of the Euclidean distances,
+// otherwise those are kept in the given storage. With reorder the solver works on the customers renumbered by
+// getSpatialOrder and the progress is numbered back before it is returned.
+RoutesProgress completeSolverClarkeWright(
+    const double &depot_x,
+    const double &depot_y,
+    const double *customers_x,
+    const double *customers_y,
+    const size_t numCustomers,
+    const double *distances,
+    const size_t maxPackages,
+    const bool exportData,
+    const std::string &filename,
+    const size_t numNeighbours,
+    const bool recordHistory,
+    const MatrixStorage storage,
+    const bool reorder)
+{
+    std::vector<Point> locations = getLocations(depot_x, depot_y, customers_x, customers_y, numCustomers);
+    SpatialOrder order;
+    if (reorder)
+    {
+        order = getSpatialOrder(locations, distances);
+    }
+    Matrix distanceMatrix = reorder ? getApiMatrix(order.locations, distances != nullptr ? order.distances.data() : nullptr, storage)
+                                    : getApiMatrix(locations, distances, storage);
+    auto [routesByIndex, routesProgress] = clarkeWrightSolver(distanceMatrix, maxPackages, numNeighbours, recordHistory);
+    if (reorder)
+    {
+        routesProgress.renumber(order.ids);
+    }
+
+    if (exportData)
+    {
+        exportRoutesProgressToCSV(routesProgress, locations, filename);
+    }
+
+    return routesProgress;
+}
+
+RoutesProgress completeSolverClarkeWright(
     const double &depot_x,
     const double &depot_y,
     const std::vector<double> &customers_x,
     const std::vector<double> &customers_y,
     const size_t maxPackages,
     const bool exportData,
-    const std::string &filename = "")
+    const std::string &filename,
+    const size_t numNeighbours,
+    const bool recordHistory)
 {
     if (customers_x.size() != customers_y.size())
     {
         throw std::invalid_argument("locations_x and locations_y must be the same length.");
     }
 
-    std::vector<Point> depots = {{depot_x, depot_y}};
+    return completeSolverClarkeWright(depot_x, depot_y, customers_x.data(), customers_y.data(), customers_x.size(), nullptr,
+                                      maxPackages, exportData, filename, numNeighbours, recordHistory);
+}
 
-    std::vector<Point> customers;
-    customers.reserve(customers_x.size());
-    for (size_t i = 0; i < customers_x.size(); ++i)
+// Takes the coordinates, an optional distance matrix and reorder like completeSolverClarkeWright.
+GeneticResult completeSolverGenetic(
+    const double &depot_x,
+    const double &depot_y,
+    const double *customers_x,
+    const double *customers_y,
+    const size_t numCustomers,
+    const double *distances,
+    const size_t maxPackages,
+    const size_t populationSize,
+    const size_t generations,
+    const float mutationProb,
+    const bool exportData,
+    const StartingType startingType,
+    const std::string &filename,
+    const GeneticOptions &options,
+    const MatrixStorage storage,
+    const bool reorder)
+{
+    std::vector<Point> locations = getLocations(depot_x, depot_y, customers_x, customers_y, numCustomers);
+    SpatialOrder order;
+    if (reorder)
     {
-        Point customer = {customers_x[i], customers_y[i]};
-        customers.push_back(customer);
+        order = getSpatialOrder(locations, distances);
     }
+    Matrix distanceMatrix = reorder ? getApiMatrix(order.locations, distances != nullptr ? order.distances.data() : nullptr, storage)
+                                    : getApiMatrix(locations, distances, storage);
 
-    Matrix distanceMatrix = getDistanceMatrix(depots, customers);
-    auto [routesByIndex, routesProgress] = clarkeWrightSolver(distanceMatrix, maxPackages);
+    GeneticResult result = geneticSolver(
+        distanceMatrix, maxPackages, populationSize, generations, mutationProb, startingType, options);
+    if (reorder)
+    {
+        result.progress.renumber(order.ids);
+    }
+
+    if (exportData)
+    {
+        exportRoutesProgressToCSV(result.progress, locations, filename);
+    }
+
+    return result;
+}
+
+GeneticResult completeSolverGenetic(
+    const double &depot_x,
+    const double &depot_y,
+    const std::vector<double> &customers_x,
+    const std::vector<double> &customers_y,
+    const size_t maxPackages,
+    const size_t populationSize,
+    const size_t generations,
+    const float mutationProb,
+    const bool exportData,
+    const StartingType startingType,
+    const std::string &filename,
+    const GeneticOptions &options)
+{
+    if (customers_x.size() != customers_y.size())
+    {
+        throw std::invalid_argument("locations_x and locations_y must be the same length.");
+    }
+
+    return completeSolverGenetic(depot_x, depot_y, customers_x.data(), customers_y.data(), customers_x.size(), nullptr,
+                                 maxPackages, populationSize, generations, mutationProb, exportData, startingType, filename, options);
+}
+
+// The sub-problems read the whole instance's matrix, so the default Coordinates storage keeps it O(n) and only the
+// sectors and windows get dense matrices of their own.
+RoutesProgress completeSolverDecomposed(
+    const double &depot_x,
+    const double &depot_y,
+    const double *customers_x,
+    const double *customers_y,
+    const size_t numCustomers,
+    const double *distances,
+    const size_t maxPackages,
+    const bool exportData,
+    const std::string &filename,
+    const DecompositionOptions &options,
+    const MatrixStorage storage)
+{
+    std::vector<Point> locations = getLocations(depot_x, depot_y, customers_x, customers_y, numCustomers);
+    Matrix distanceMatrix = getApiMatrix(locations, distances, storage);
+    auto [routes, routesProgress] = decompositionSolver(distanceMatrix, locations, maxPackages, options);
 
     if (exportData)
     {
-        std::vector<Point>
-            locations(depots.size() + customers.size());
-        std::copy(depots.begin(), depots.end(), locations.begin());
-        std::copy(customers.begin(), customers.end(), locations.begin() + depots.size());
         exportRoutesProgressToCSV(routesProgress, locations, filename);
     }
 
     return routesProgress;
 }
 
-std::vector<std::vector<std::vector<int>>> completeSolverGenetic(
+// completeSolverGenetic on its own thread, returns straight away. The job copies the arguments it needs.
+// distances is an optional row-major distance matrix like in completeSolverGenetic, empty for Euclidean distances.
+std::unique_ptr<SolveJob> startSolverGenetic(
     const double &depot_x,
     const double &depot_y,
     const std::vector<double> &customers_x,
@@ -55,37 +257,125 @@ std::vector<std::vector<std::vector<int>>> completeSolverGenetic(
     const size_t generations,
     const float mutationProb,
     const bool exportData,
-    const StartingType startingType = StartingType::ClarkeWright,
-    const std::string &filename = "")
+    const StartingType startingType,
+    const std::string &filename,
+    const GeneticOptions &options,
+    const std::vector<double> &distances)
 {
     if (customers_x.size() != customers_y.size())
     {
         throw std::invalid_argument("locations_x and locations_y must be the same length.");
     }
+    const size_t numLocations = customers_x.size() + 1;
+    if (!distances.empty() && distances.size() != numLocations * numLocations)
+    {
+        throw std::invalid_argument("distances must have (number of customers + 1)^2 values, got: " + std::to_string(distances.size()));
+    }
 
-    std::vector<Point> depots = {{depot_x, depot_y}};
+    return std::make_unique<SolveJob>(
+        [=](SolveMonitor &monitor)
+        {
+            GeneticOptions jobOptions = options;
+            jobOptions.monitor = &monitor;
+            return completeSolverGenetic(depot_x, depot_y, customers_x.data(), customers_y.data(), customers_x.size(),
+                                         distances.empty() ? nullptr : distances.data(), maxPackages, populationSize,
+                                         generations, mutationProb, exportData, startingType, filename, jobOptions);
+        });
+}
+
+/* Runs solve(i) for every instance and times the whole batch
+    - Instances with at least largeInstanceSize customers run one at a time first, so the solver can use every
+      core itself.
+    - The rest run in parallel, one instance per thread with the largest first so the threads finish together.
+      Their solvers' own parallel loops then run on that one thread.
+    - If instances throw, the first of them in input order is rethrown once all instances are done.
+*/
+template <typename Result, typename Solve>
+static BatchResult<Result> solveBatch(const std::vector<BatchInstance> &instances, const size_t largeInstanceSize, const Solve &solve)
+{
+    const auto start = std::chrono::steady_clock::now();
 
-    std::vector<Point> customers;
-    customers.reserve(customers_x.size());
-    for (size_t i = 0; i < customers_x.size(); ++i)
+    std::vector<size_t> large;
+    std::vector<size_t> small;
+    for (size_t i = 0; i < instances.size(); ++i)
     {
-        Point customer = {customers_x[i], customers_y[i]};
-        customers.push_back(customer);
+        if (instances[i].customers_x.size() != instances[i].customers_y.size())
+        {
+            throw std::invalid_argument("locations_x and locations_y of instance " + std::to_string(i) + " must be the same length.");
+        }
+        (instances[i].customers_x.size() >= largeInstanceSize ? large : small).push_back(i);
     }
+    std::stable_sort(small.begin(), small.end(), [&](size_t a, size_t b)
+                     { return instances[a].customers_x.size() > instances[b].customers_x.size(); });
 
-    Matrix distanceMatrix = getDistanceMatrix(depots, customers);
+    std::vector<Result> results(instances.size());
+    std::vector<std::exception_ptr> errors(instances.size());
+    auto run = [&](const size_t i)
+    {
+        try
+        {
+            results[i] = solve(instances[i]);
+        }
+        catch (...)
+        {
+            errors[i] = std::current_exception();
+        }
+    };
 
-    std::vector<std::vector<std::vector<int>>> routesProgress = geneticSolver(
-        distanceMatrix, maxPackages, populationSize, generations, mutationProb, startingType);
+    for (size_t i : large)
+    {
+        run(i);
+    }
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t k = 0; k < small.size(); ++k)
+    {
+        run(small[k]);
+    }
 
-    if (exportData)
+    for (const auto &error : errors)
     {
-        std::vector<Point>
-            locations(depots.size() + customers.size());
-        std::copy(depots.begin(), depots.end(), locations.begin());
-        std::copy(customers.begin(), customers.end(), locations.begin() + depots.size());
-        exportRoutesProgressToCSV(routesProgress, locations, filename);
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
     }
 
-    return routesProgress;
+    BatchResult<Result> batch;
+    batch.results = std::move(results);
+    batch.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    batch.instancesPerSecond = batch.seconds > 0.0 ? instances.size() / batch.seconds : 0.0;
+    return batch;
+}
+
+// completeSolverClarkeWright for many instances at once, without exporting. See solveBatch for the scheduling.
+BatchResult<RoutesProgress> completeSolverClarkeWrightBatch(
+    const std::vector<BatchInstance> &instances,
+    const size_t numNeighbours,
+    const bool recordHistory,
+    const size_t largeInstanceSize)
+{
+    return solveBatch<RoutesProgress>(instances, largeInstanceSize, [&](const BatchInstance &instance)
+                                      { return completeSolverClarkeWright(instance.depot_x, instance.depot_y, instance.customers_x.data(), instance.customers_y.data(),
+                                                                          instance.customers_x.size(), nullptr, instance.maxPackages, false, "", numNeighbours, recordHistory); });
+}
+
+// completeSolverGenetic for many instances at once with the same settings, without exporting. There is no monitor, as
+// the instances would all report to the same one at the same time.
+BatchResult<GeneticResult> completeSolverGeneticBatch(
+    const std::vector<BatchInstance> &instances,
+    const size_t populationSize,
+    const size_t generations,
+    const float mutationProb,
+    const StartingType startingType,
+    const GeneticOptions &options,
+    const size_t largeInstanceSize)
+{
+    if (options.monitor != nullptr)
+    {
+        throw std::invalid_argument("options.monitor must be null for a batch, its instances would all report to it at once.");
+    }
+    return solveBatch<GeneticResult>(instances, largeInstanceSize, [&](const BatchInstance &instance)
+                                     { return completeSolverGenetic(instance.depot_x, instance.depot_y, instance.customers_x.data(), instance.customers_y.data(),
+                                                                    instance.customers_x.size(), nullptr, instance.maxPackages, populationSize, generations,
+                                                                    mutationProb, false, startingType, "", options); });
 }
\ No newline at end of file
@@ -0,0 +1,816 @@
+#include "utils.h"
+#include "genetic_algo_utils.h"
+#include "genetic_algorithm.h"
+#include "create_child.h"
+#include "local_search.h"
+#include "clarke_wright.h"
+#include "api_solvers.h"
+#include "decomposition.h"
+#include "spatial_index.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <omp.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+/*
+Benchmarks for comparing solver components on the same seeded instances.
+Run all of them with ./vrp_bench or a single one with ./vrp_bench <name>.
+*/
+
+const double minDistance = 100;
+const double maxDistance = 1000;
+const double centerCoords = 550;
+
+double secondsSince(const std::chrono::steady_clock::time_point &start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string localSearchName(const LocalSearchType engine)
+{
+    switch (engine)
+    {
+    case LocalSearchType::TwoOptSwap:
+        return "TwoOptSwap";
+    case LocalSearchType::IntraRoute:
+        return "IntraRoute";
+    case LocalSearchType::IntraInterRoute:
+        return "IntraInter";
+    default:
+        return "?";
+    }
+}
+
+Matrix seededInstance(const size_t numCustomers, const unsigned int seed)
+{
+    std::vector<Point> depots = {{centerCoords, centerCoords}};
+    std::vector<Point> customers = getRandomPoints(numCustomers, minDistance, maxDistance, seed);
+    return getDistanceMatrix(depots, customers);
+}
+
+// Random routes with exactly maxPackages customers each, so the intra-route search has long routes to work on.
+std::vector<Individual> seededRandomIndividuals(const Matrix &distMatrix, const size_t count, const size_t maxPackages, const unsigned int seed)
+{
+    std::mt19937 gen(seed);
+    std::vector<Individual> individuals;
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::vector<int> locations(distMatrix.size() - 1);
+        std::iota(locations.begin(), locations.end(), 1);
+        std::shuffle(locations.begin(), locations.end(), gen);
+
+        std::vector<std::vector<int>> routes;
+        for (size_t start = 0; start < locations.size(); start += maxPackages)
+        {
+            size_t end = std::min(locations.size(), start + maxPackages);
+            std::vector<int> route = {0};
+            route.insert(route.end(), locations.begin() + start, locations.begin() + end);
+            route.push_back(0);
+            routes.push_back(route);
+        }
+        individuals.emplace_back(routes, distanceOfRoutes(routes, distMatrix));
+    }
+    return individuals;
+}
+
+// Compares the original twoOptSwap with the delta-evaluated local search engines on identical random routes.
+void benchmarkLocalSearch()
+{
+    std::cout << "localsearch: local search on 20 random individuals\n";
+    std::cout << std::setw(10) << "customers" << std::setw(12) << "maxPackages" << std::setw(14) << "engine"
+              << std::setw(14) << "distance" << std::setw(12) << "ms" << "\n";
+
+    const std::vector<std::pair<size_t, size_t>> sizes = {{200, 10}, {200, 25}, {1000, 50}, {1000, 100}};
+    for (const auto &[numCustomers, maxPackages] : sizes)
+    {
+        Matrix distMatrix = seededInstance(numCustomers, 1);
+        const std::vector<Individual> start = seededRandomIndividuals(distMatrix, 20, maxPackages, 2);
+
+        for (LocalSearchType engine : {LocalSearchType::TwoOptSwap, LocalSearchType::IntraRoute, LocalSearchType::IntraInterRoute})
+        {
+            std::vector<Individual> individuals = start;
+            auto timer = std::chrono::steady_clock::now();
+            for (auto &individual : individuals)
+            {
+                if (engine == LocalSearchType::TwoOptSwap)
+                {
+                    twoOptSwap(individual, distMatrix);
+                }
+                else if (engine == LocalSearchType::IntraRoute)
+                {
+                    intraRouteSearch(individual, distMatrix);
+                }
+                else
+                {
+                    interRouteSearch(individual, distMatrix, maxPackages);
+                }
+            }
+            double seconds = secondsSince(timer);
+
+            double totalDistance = 0.0;
+            for (auto &individual : individuals)
+            {
+                totalDistance += distanceOfRoutes(individual.routes, distMatrix);
+            }
+            std::cout << std::setw(10) << numCustomers << std::setw(12) << maxPackages
+                      << std::setw(14) << localSearchName(engine)
+                      << std::setw(14) << std::fixed << std::setprecision(1) << totalDistance / individuals.size()
+                      << std::setw(12) << std::setprecision(2) << seconds * 1000 << "\n";
+        }
+    }
+
+    std::cout << "\nlocalsearch: geneticSolver, 200 customers, maxPackages 10, population 50, 100 generations\n";
+    Matrix distMatrix = seededInstance(200, 3);
+    for (LocalSearchType engine : {LocalSearchType::TwoOptSwap, LocalSearchType::IntraRoute, LocalSearchType::IntraInterRoute})
+    {
+        GeneticOptions options;
+        options.localSearch = engine;
+        auto timer = std::chrono::steady_clock::now();
+        auto result = geneticSolver(distMatrix, 10, 50, 100, 0.5f, StartingType::NearestNeighbours, options);
+        double seconds = secondsSince(timer);
+        std::cout << std::setw(14) << localSearchName(engine)
+                  << std::setw(14) << std::fixed << std::setprecision(1) << distanceOfRoutes(result.progress.back(), distMatrix)
+                  << std::setw(12) << std::setprecision(2) << seconds * 1000 << " ms\n";
+    }
+}
+
+// Compares Clarke-Wright with the full savings list against granular neighbour lists of different sizes.
+void benchmarkSavings()
+{
+    std::cout << "savings: clarkeWrightSolver with granular neighbour lists, maxPackages 20, 3 seeds per size\n";
+    std::cout << std::setw(10) << "customers" << std::setw(12) << "neighbours" << std::setw(14) << "distance"
+              << std::setw(10) << "gap %" << std::setw(12) << "ms" << "\n";
+
+    const size_t maxPackages = 20;
+    for (size_t numCustomers : {500, 1000, 2000, 5000})
+    {
+        std::vector<Matrix> instances;
+        for (unsigned int seed = 1; seed <= 3; ++seed)
+        {
+            instances.push_back(seededInstance(numCustomers, seed));
+        }
+
+        double fullDistance = 0.0;
+        for (size_t numNeighbours : {0, 40, 20, 10, 5})
+        {
+            double totalDistance = 0.0;
+            auto timer = std::chrono::steady_clock::now();
+            for (const auto &distMatrix : instances)
+            {
+                auto [routes, routesProgress] = clarkeWrightSolver(distMatrix, maxPackages, numNeighbours);
+                totalDistance += distanceOfRoutes(routes, distMatrix);
+            }
+            double seconds = secondsSince(timer);
+            if (numNeighbours == 0)
+            {
+                fullDistance = totalDistance;
+            }
+
+            std::cout << std::setw(10) << numCustomers << std::setw(12) << (numNeighbours == 0 ? "all" : std::to_string(numNeighbours))
+                      << std::setw(14) << std::fixed << std::setprecision(1) << totalDistance / instances.size()
+                      << std::setw(10) << std::setprecision(2) << 100.0 * (totalDistance - fullDistance) / fullDistance
+                      << std::setw(12) << seconds * 1000 / instances.size() << "\n";
+        }
+    }
+}
+
+// Compares one population against islands with the same number of individuals in total.
+void benchmarkIslands()
+{
+    std::cout << "islands: geneticSolver from random routes, 200 customers, maxPackages 10, 200 individuals, 200 generations, 3 seeds\n";
+    std::cout << std::setw(10) << "islands" << std::setw(12) << "topology" << std::setw(14) << "distance" << std::setw(12) << "ms" << "\n";
+
+    Matrix distMatrix = seededInstance(200, 4);
+    const size_t totalPopulation = 200;
+    for (size_t count : {1, 4, 8})
+    {
+        for (MigrationTopology topology : {MigrationTopology::Ring, MigrationTopology::Random})
+        {
+            if (count == 1 && topology == MigrationTopology::Random)
+            {
+                continue;
+            }
+
+            double totalDistance = 0.0;
+            auto timer = std::chrono::steady_clock::now();
+            for (unsigned int seed = 1; seed <= 3; ++seed)
+            {
+                GeneticOptions options;
+                options.seed = seed;
+                options.recordHistory = false;
+                options.islands.count = count;
+                options.islands.topology = topology;
+                auto result = geneticSolver(distMatrix, 10, totalPopulation / count, 200, 0.5f, StartingType::Random, options);
+                totalDistance += distanceOfRoutes(result.progress.back(), distMatrix);
+            }
+            double seconds = secondsSince(timer);
+
+            std::cout << std::setw(10) << count << std::setw(12) << (count == 1 ? "-" : topology == MigrationTopology::Ring ? "Ring" : "Random")
+                      << std::setw(14) << std::fixed << std::setprecision(1) << totalDistance / 3
+                      << std::setw(12) << std::setprecision(2) << seconds * 1000 / 3 << "\n";
+        }
+    }
+}
+
+// Many small instances, solved one call at a time and as one batch.
+void benchmarkBatch()
+{
+    std::cout << "batch: 2000 instances of 20-80 customers, maxPackages 8\n";
+    std::cout << std::setw(14) << "solver" << std::setw(12) << "mode" << std::setw(16) << "instances/s" << "\n";
+
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<size_t> customerDist(20, 80);
+    std::vector<BatchInstance> instances(2000);
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+        std::vector<Point> customers = getRandomPoints(customerDist(gen), minDistance, maxDistance, i);
+        instances[i].depot_x = centerCoords;
+        instances[i].depot_y = centerCoords;
+        instances[i].maxPackages = 8;
+        for (const auto &customer : customers)
+        {
+            instances[i].customers_x.push_back(customer.x);
+            instances[i].customers_y.push_back(customer.y);
+        }
+    }
+
+    GeneticOptions options;
+    options.recordHistory = false;
+    const size_t geneticInstances = 200;
+    const std::vector<BatchInstance> geneticBatch(instances.begin(), instances.begin() + geneticInstances);
+
+    auto timer = std::chrono::steady_clock::now();
+    for (const auto &instance : instances)
+    {
+        completeSolverClarkeWright(instance.depot_x, instance.depot_y, instance.customers_x, instance.customers_y, instance.maxPackages, false, "", 0, false);
+    }
+    double seconds = secondsSince(timer);
+    std::cout << std::setw(14) << "ClarkeWright" << std::setw(12) << "single" << std::setw(16) << std::fixed << std::setprecision(1) << instances.size() / seconds << "\n";
+    std::cout << std::setw(14) << "ClarkeWright" << std::setw(12) << "batch" << std::setw(16) << completeSolverClarkeWrightBatch(instances).instancesPerSecond << "\n";
+
+    timer = std::chrono::steady_clock::now();
+    for (const auto &instance : geneticBatch)
+    {
+        completeSolverGenetic(instance.depot_x, instance.depot_y, instance.customers_x, instance.customers_y, instance.maxPackages,
+                              20, 20, 0.5f, false, StartingType::Mixed, "", options);
+    }
+    seconds = secondsSince(timer);
+    std::cout << std::setw(14) << "Genetic" << std::setw(12) << "single" << std::setw(16) << geneticBatch.size() / seconds << "\n";
+    std::cout << std::setw(14) << "Genetic" << std::setw(12) << "batch"
+              << std::setw(16) << completeSolverGeneticBatch(geneticBatch, 20, 20, 0.5f, StartingType::Mixed, options).instancesPerSecond << "\n";
+}
+
+size_t matrixBytes(const Matrix &distMatrix)
+{
+    return distMatrix.data.size() * sizeof(double) + distMatrix.rows.size() * sizeof(double *) +
+           (distMatrix.xs.size() + distMatrix.ys.size()) * sizeof(double) + distMatrix.locations.size() * sizeof(Point) +
+           distMatrix.floatData.size() * sizeof(float) + distMatrix.fixedData.size() * sizeof(std::uint16_t);
+}
+
+std::string storageName(const MatrixStorage storage)
+{
+    switch (storage)
+    {
+    case MatrixStorage::Dense:
+        return "Dense";
+    case MatrixStorage::Coordinates:
+        return "Coordinates";
+    case MatrixStorage::PackedTriangular:
+        return "Triangular";
+    case MatrixStorage::Float32:
+        return "Float32";
+    case MatrixStorage::FixedPoint:
+        return "FixedPoint";
+    default:
+        return "?";
+    }
+}
+
+// Counts the last-level cache misses of the calling thread and the threads it starts while the counter lives.
+// count() is -1 where the kernel gives no hardware counters, e.g. in most virtual machines.
+class CacheMissCounter
+{
+public:
+    CacheMissCounter()
+    {
+#ifdef __linux__
+        perf_event_attr attributes;
+        std::memset(&attributes, 0, sizeof(attributes));
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.size = sizeof(attributes);
+        attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+        attributes.inherit = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+    }
+
+    ~CacheMissCounter()
+    {
+#ifdef __linux__
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+#endif
+    }
+
+    long long count() const
+    {
+        long long misses = -1;
+#ifdef __linux__
+        if (fd < 0 || read(fd, &misses, sizeof(misses)) != sizeof(misses))
+        {
+            return -1;
+        }
+#endif
+        return misses;
+    }
+
+private:
+    int fd = -1;
+};
+
+// Dense against Coordinates storage: memory, build time and Clarke-Wright with 20 neighbours on the same instances.
+void benchmarkStorage()
+{
+    std::cout << "storage: getDistanceMatrix and clarkeWrightSolver with 20 neighbours, maxPackages 20\n";
+    std::cout << std::setw(10) << "customers" << std::setw(14) << "storage" << std::setw(12) << "MB" << std::setw(12) << "build ms"
+              << std::setw(12) << "solve ms" << std::setw(14) << "distance" << "\n";
+
+    for (size_t numCustomers : {2000, 10000, 100000})
+    {
+        std::vector<Point> depots = {{centerCoords, centerCoords}};
+        std::vector<Point> customers = getRandomPoints(numCustomers, minDistance, maxDistance, 1);
+        for (MatrixStorage storage : {MatrixStorage::Dense, MatrixStorage::Coordinates})
+        {
+            // A dense matrix of 100000 customers would need 80 GB
+            if (storage == MatrixStorage::Dense && numCustomers > 10000)
+            {
+                continue;
+            }
+
+            auto timer = std::chrono::steady_clock::now();
+            Matrix distMatrix = getDistanceMatrix(depots, customers, storage);
+            double buildSeconds = secondsSince(timer);
+
+            timer = std::chrono::steady_clock::now();
+            auto [routes, routesProgress] = clarkeWrightSolver(distMatrix, 20, 20, false);
+            double solveSeconds = secondsSince(timer);
+
+            std::cout << std::setw(10) << numCustomers << std::setw(14) << storageName(storage)
+                      << std::setw(12) << std::fixed << std::setprecision(1) << matrixBytes(distMatrix) / 1e6
+                      << std::setw(12) << std::setprecision(2) << buildSeconds * 1000
+                      << std::setw(12) << solveSeconds * 1000
+                      << std::setw(14) << std::setprecision(1) << distanceOfRoutes(routes, distMatrix) << "\n";
+        }
+    }
+
+    // The drift is how far the distance the solver saw is from the exact distance of the same routes
+    std::cout << "\nstorage: 2000 customers, maxPackages 50, intra-route search on 20 random individuals and\n"
+              << "geneticSolver from random routes with population 30 and 50 generations\n";
+    std::cout << std::setw(14) << "storage" << std::setw(10) << "MB" << std::setw(12) << "2-opt ms" << std::setw(12) << "GA ms"
+              << std::setw(14) << "GA distance" << std::setw(12) << "drift %" << "\n";
+
+    std::vector<Point> depots = {{centerCoords, centerCoords}};
+    std::vector<Point> customers = getRandomPoints(2000, minDistance, maxDistance, 6);
+    const Matrix exact = getDistanceMatrix(depots, customers);
+    const std::vector<Individual> start = seededRandomIndividuals(exact, 20, 50, 7);
+    for (MatrixStorage storage : {MatrixStorage::Dense, MatrixStorage::Coordinates, MatrixStorage::PackedTriangular, MatrixStorage::Float32, MatrixStorage::FixedPoint})
+    {
+        Matrix distMatrix = getDistanceMatrix(depots, customers, storage);
+
+        std::vector<Individual> individuals = start;
+        auto timer = std::chrono::steady_clock::now();
+        for (auto &individual : individuals)
+        {
+            intraRouteSearch(individual, distMatrix);
+        }
+        double searchSeconds = secondsSince(timer);
+
+        GeneticOptions options;
+        options.seed = 1;
+        options.recordHistory = false;
+        timer = std::chrono::steady_clock::now();
+        auto result = geneticSolver(distMatrix, 50, 30, 50, 0.5f, StartingType::Random, options);
+        double geneticSeconds = secondsSince(timer);
+
+        const auto routes = result.progress.back();
+        const double seen = distanceOfRoutes(routes, distMatrix);
+        const double exactDistance = distanceOfRoutes(routes, exact);
+        std::cout << std::setw(14) << storageName(storage)
+                  << std::setw(10) << std::fixed << std::setprecision(1) << matrixBytes(distMatrix) / 1e6
+                  << std::setw(12) << std::setprecision(2) << searchSeconds * 1000
+                  << std::setw(12) << geneticSeconds * 1000
+                  << std::setw(14) << std::setprecision(1) << exactDistance
+                  << std::setw(12) << std::setprecision(5) << 100.0 * (seen - exactDistance) / exactDistance << "\n";
+    }
+}
+
+// getDistanceMatrix build time of every stored layout against the full-savings Clarke-Wright solve on the dense matrix.
+void benchmarkMatrix()
+{
+    std::cout << "matrix: getDistanceMatrix build ms per storage and clarkeWrightSolver with all savings, maxPackages 20\n";
+    std::cout << std::setw(10) << "customers" << std::setw(12) << "Dense" << std::setw(12) << "Triangular" << std::setw(12) << "Float32"
+              << std::setw(12) << "FixedPoint" << std::setw(12) << "solve ms" << "\n";
+
+    for (size_t numCustomers : {2000, 5000, 10000})
+    {
+        std::vector<Point> depots = {{centerCoords, centerCoords}};
+        std::vector<Point> customers = getRandomPoints(numCustomers, minDistance, maxDistance, 8);
+        std::cout << std::setw(10) << numCustomers << std::fixed << std::setprecision(2);
+        for (MatrixStorage storage : {MatrixStorage::Dense, MatrixStorage::PackedTriangular, MatrixStorage::Float32, MatrixStorage::FixedPoint})
+        {
+            auto timer = std::chrono::steady_clock::now();
+            Matrix distMatrix = getDistanceMatrix(depots, customers, storage);
+            std::cout << std::setw(12) << secondsSince(timer) * 1000;
+        }
+
+        Matrix distMatrix = getDistanceMatrix(depots, customers);
+        auto timer = std::chrono::steady_clock::now();
+        auto [routes, routesProgress] = clarkeWrightSolver(distMatrix, 20, 0, false);
+        std::cout << std::setw(12) << secondsSince(timer) * 1000 << "\n";
+    }
+}
+
+/* Customers in random order against the same customers renumbered along a Hilbert curve
+    - The API solvers with and without reorder, best of three runs each after a warm-up solve, since the first large
+      matrix of the process pays for its page faults.
+    - Route evaluation: distanceOfRoutes of the Clarke-Wright routes 200 times on the dense matrix in each numbering,
+      the part of the solvers that only depends on where the distances sit in memory.
+*/
+void benchmarkReorder()
+{
+    const size_t numCustomers = 10000;
+    const int runs = 3;
+    std::cout << "reorder: " << numCustomers << " customers in random order, Clarke-Wright with 20 neighbours and maxPackages 20,\n"
+              << "geneticSolver from nearest neighbour routes with population 20 and 20 generations, best of " << runs << " runs\n";
+    std::cout << std::setw(14) << "solver" << std::setw(10) << "reorder" << std::setw(12) << "ms" << std::setw(16) << "cache misses"
+              << std::setw(14) << "distance" << "\n";
+
+    std::vector<Point> customers = getRandomPoints(numCustomers, minDistance, maxDistance, 9);
+    std::vector<double> customers_x;
+    std::vector<double> customers_y;
+    for (const auto &customer : customers)
+    {
+        customers_x.push_back(customer.x);
+        customers_y.push_back(customer.y);
+    }
+    const Matrix exact = getDistanceMatrix({{centerCoords, centerCoords}}, customers, MatrixStorage::Coordinates);
+
+    auto solve = [&](const bool genetic, const bool reorder)
+    {
+        if (!genetic)
+        {
+            return completeSolverClarkeWright(centerCoords, centerCoords, customers_x.data(), customers_y.data(), numCustomers, nullptr,
+                                              20, false, "", 20, false, MatrixStorage::Dense, reorder);
+        }
+        GeneticOptions options;
+        options.seed = 1;
+        options.recordHistory = false;
+        return completeSolverGenetic(centerCoords, centerCoords, customers_x.data(), customers_y.data(), numCustomers, nullptr,
+                                     20, 20, 20, 0.5f, false, StartingType::NearestNeighbours, "", options, MatrixStorage::Dense, reorder)
+            .progress;
+    };
+    auto printRow = [](const std::string &name, const bool reorder, const double seconds, const long long misses, const double distance)
+    {
+        std::cout << std::setw(14) << name << std::setw(10) << (reorder ? "yes" : "no")
+                  << std::setw(12) << std::fixed << std::setprecision(2) << seconds * 1000
+                  << std::setw(16) << (misses < 0 ? std::string("n/a") : std::to_string(misses))
+                  << std::setw(14) << std::setprecision(1) << distance << "\n";
+    };
+
+    const std::vector<std::vector<int>> routes = solve(false, false).back();
+    for (bool genetic : {false, true})
+    {
+        double bestSeconds[2] = {std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()};
+        long long misses[2] = {-1, -1};
+        double distance[2] = {0.0, 0.0};
+        for (int run = 0; run < runs; ++run)
+        {
+            for (bool reorder : {false, true})
+            {
+                CacheMissCounter counter;
+                auto timer = std::chrono::steady_clock::now();
+                RoutesProgress progress = solve(genetic, reorder);
+                double seconds = secondsSince(timer);
+                if (seconds < bestSeconds[reorder])
+                {
+                    bestSeconds[reorder] = seconds;
+                    misses[reorder] = counter.count();
+                }
+                distance[reorder] = distanceOfRoutes(progress.back(), exact);
+            }
+        }
+        for (bool reorder : {false, true})
+        {
+            printRow(genetic ? "Genetic" : "ClarkeWright", reorder, bestSeconds[reorder], misses[reorder], distance[reorder]);
+        }
+    }
+
+    // The same routes and dense matrix with the customers renumbered like reorder does
+    std::vector<int> curve = hilbertOrder(customers);
+    std::vector<Point> curveCustomers;
+    std::vector<int> curveIds(numCustomers + 1, 0);
+    for (size_t k = 0; k < numCustomers; ++k)
+    {
+        curveCustomers.push_back(customers[curve[k]]);
+        curveIds[curve[k] + 1] = static_cast<int>(k) + 1;
+    }
+    std::vector<std::vector<int>> curveRoutes = routes;
+    for (auto &route : curveRoutes)
+    {
+        for (int &customer : route)
+        {
+            customer = curveIds[customer];
+        }
+    }
+    const Matrix given = getDistanceMatrix({{centerCoords, centerCoords}}, customers);
+    const Matrix renumbered = getDistanceMatrix({{centerCoords, centerCoords}}, curveCustomers);
+    for (bool reorder : {false, true})
+    {
+        CacheMissCounter counter;
+        auto timer = std::chrono::steady_clock::now();
+        double total = 0.0;
+        for (int repeat = 0; repeat < 200; ++repeat)
+        {
+            total += distanceOfRoutes(reorder ? curveRoutes : routes, reorder ? renumbered : given);
+        }
+        printRow("Evaluation", reorder, secondsSince(timer), counter.count(), total / 200);
+    }
+}
+
+// Whole-instance Clarke-Wright against the decomposition solver with Clarke-Wright and genetic sub-solves.
+void benchmarkDecomposition()
+{
+    const size_t numCustomers = 20000;
+    const size_t maxPackages = 20;
+    std::cout << "decomposition: " << numCustomers << " customers, maxPackages " << maxPackages << ", Coordinates storage, Clarke-Wright with 20 neighbours,\n"
+              << "genetic sub-solves with population 10 and 20 generations, windows of 8 routes\n";
+    std::cout << std::setw(24) << "solver" << std::setw(12) << "partition" << std::setw(12) << "ms" << std::setw(14) << "distance" << "\n";
+
+    std::vector<Point> locations = {{centerCoords, centerCoords}};
+    std::vector<Point> customers = getRandomPoints(numCustomers, minDistance, maxDistance, 10);
+    locations.insert(locations.end(), customers.begin(), customers.end());
+    const Matrix distMatrix = getDistanceMatrix({locations[0]}, customers, MatrixStorage::Coordinates);
+
+    auto timer = std::chrono::steady_clock::now();
+    auto [wholeRoutes, wholeProgress] = clarkeWrightSolver(distMatrix, maxPackages, 20, false);
+    std::cout << std::setw(24) << "ClarkeWright" << std::setw(12) << "-"
+              << std::setw(12) << std::fixed << std::setprecision(2) << secondsSince(timer) * 1000
+              << std::setw(14) << std::setprecision(1) << distanceOfRoutes(wholeRoutes, distMatrix) << "\n";
+
+    for (SubSolver subSolver : {SubSolver::ClarkeWright, SubSolver::Genetic})
+    {
+        for (size_t partitionSize : {500, 2000})
+        {
+            for (size_t windowRoutes : {0, 8})
+            {
+                DecompositionOptions options;
+                options.partitionSize = partitionSize;
+                options.windowRoutes = windowRoutes;
+                options.subSolver = subSolver;
+                options.recordHistory = false;
+                options.numNeighbours = 20;
+                options.populationSize = 10;
+                options.generations = 20;
+                options.startingType = StartingType::ClarkeWright;
+                options.genetic.seed = 1;
+
+                timer = std::chrono::steady_clock::now();
+                auto [routes, progress] = decompositionSolver(distMatrix, locations, maxPackages, options);
+                const std::string name = std::string(subSolver == SubSolver::Genetic ? "Genetic" : "ClarkeWright") + (windowRoutes > 0 ? " + windows" : "");
+                std::cout << std::setw(24) << name << std::setw(12) << partitionSize
+                          << std::setw(12) << std::setprecision(2) << secondsSince(timer) * 1000
+                          << std::setw(14) << std::setprecision(1) << distanceOfRoutes(routes, distMatrix) << "\n";
+            }
+        }
+    }
+}
+
+// Nearest-neighbour seeding with the k-d tree against the scan over the customers left, which it falls back to when
+// the matrix has no locations.
+void benchmarkNearestNeighbour()
+{
+    const size_t maxPackages = 20;
+    std::cout << "nearest neighbour: createNearestNeighbourIndividual, maxPackages " << maxPackages << ", best of 3\n";
+    std::cout << std::setw(10) << "customers" << std::setw(12) << "search" << std::setw(12) << "ms" << std::setw(14) << "distance" << "\n";
+
+    for (size_t numCustomers : {2000, 5000, 10000})
+    {
+        Matrix distMatrix = getDistanceMatrix({{centerCoords, centerCoords}}, getRandomPoints(numCustomers, minDistance, maxDistance, 12));
+        const std::vector<Point> locations = distMatrix.locations;
+        for (bool tree : {false, true})
+        {
+            distMatrix.locations = tree ? locations : std::vector<Point>();
+            double best = std::numeric_limits<double>::infinity();
+            double distance = 0.0;
+            for (int repeat = 0; repeat < 3; ++repeat)
+            {
+                auto timer = std::chrono::steady_clock::now();
+                distance = createNearestNeighbourIndividual(distMatrix, maxPackages).total_distance;
+                best = std::min(best, secondsSince(timer));
+            }
+            std::cout << std::setw(10) << numCustomers << std::setw(12) << (tree ? "k-d tree" : "scan")
+                      << std::setw(12) << std::fixed << std::setprecision(2) << best * 1000
+                      << std::setw(14) << std::setprecision(1) << distance << "\n";
+        }
+    }
+}
+
+// The route representation of the genetic solver against giant tours split into routes, on the same instances.
+void benchmarkRepresentation()
+{
+    const size_t maxPackages = 10;
+    std::cout << "representation: geneticSolver, maxPackages " << maxPackages << ", 50 individuals, 100 generations, IntraRoute search, 3 seeds\n";
+    std::cout << std::setw(10) << "customers" << std::setw(14) << "start" << std::setw(16) << "representation"
+              << std::setw(14) << "distance" << std::setw(12) << "ms" << "\n";
+
+    for (size_t numCustomers : {200, 1000})
+    {
+        Matrix distMatrix = seededInstance(numCustomers, 6);
+        for (StartingType startingType : {StartingType::Random, StartingType::ClarkeWright})
+        {
+            for (Representation representation : {Representation::Routes, Representation::GiantTour})
+            {
+                double totalDistance = 0.0;
+                auto timer = std::chrono::steady_clock::now();
+                for (unsigned int seed = 1; seed <= 3; ++seed)
+                {
+                    GeneticOptions options;
+                    options.seed = seed;
+                    options.recordHistory = false;
+                    options.representation = representation;
+                    auto result = geneticSolver(distMatrix, maxPackages, 50, 100, 0.5f, startingType, options);
+                    totalDistance += distanceOfRoutes(result.progress.back(), distMatrix);
+                }
+                double seconds = secondsSince(timer);
+
+                std::cout << std::setw(10) << numCustomers << std::setw(14) << (startingType == StartingType::Random ? "Random" : "ClarkeWright")
+                          << std::setw(16) << (representation == Representation::Routes ? "Routes" : "GiantTour")
+                          << std::setw(14) << std::fixed << std::setprecision(1) << totalDistance / 3
+                          << std::setw(12) << std::setprecision(2) << seconds * 1000 / 3 << "\n";
+            }
+        }
+    }
+}
+
+// routeCrossover alone on random parents, where the routes left of the second parent are short and many merge.
+void benchmarkCrossover()
+{
+    std::cout << "crossover: routeCrossover of random parents, 200 children, best of 3\n";
+    std::cout << std::setw(10) << "customers" << std::setw(12) << "maxPackages" << std::setw(12) << "routes" << std::setw(14) << "distance" << std::setw(12) << "ms" << "\n";
+
+    for (const auto &[numCustomers, maxPackages] : std::vector<std::pair<size_t, size_t>>{{500, 10}, {2000, 10}, {2000, 50}})
+    {
+        Matrix distMatrix = seededInstance(numCustomers, 8);
+        const std::vector<Individual> parents = getRandomPopulation(distMatrix, 20, maxPackages, 9);
+        double best = std::numeric_limits<double>::infinity();
+        double totalDistance = 0.0;
+        size_t totalRoutes = 0;
+        for (int repeat = 0; repeat < 3; ++repeat)
+        {
+            Individual child;
+            totalDistance = 0.0;
+            totalRoutes = 0;
+            auto timer = std::chrono::steady_clock::now();
+            for (size_t k = 0; k < 200; ++k)
+            {
+                routeCrossover(parents[k % parents.size()], parents[(k * 7 + 3) % parents.size()], maxPackages, distMatrix, child);
+                updateTotalDistance(child);
+                totalDistance += child.total_distance;
+                totalRoutes += child.routes.size();
+            }
+            best = std::min(best, secondsSince(timer));
+        }
+        std::cout << std::setw(10) << numCustomers << std::setw(12) << maxPackages << std::setw(12) << totalRoutes / 200
+                  << std::setw(14) << std::fixed << std::setprecision(1) << totalDistance / 200
+                  << std::setw(12) << std::setprecision(2) << best * 1000 << "\n";
+    }
+}
+
+// Generations per second of geneticSolver for each local search as the number of OpenMP threads grows.
+void benchmarkThreads()
+{
+    std::cout << "threads: geneticSolver from random routes, 300 customers, maxPackages 10, 128 individuals, 50 generations\n";
+    std::cout << std::setw(12) << "search" << std::setw(10) << "threads" << std::setw(16) << "generations/s" << "\n";
+
+    Matrix distMatrix = seededInstance(300, 8);
+    const int defaultThreads = omp_get_max_threads();
+    for (LocalSearchType engine : {LocalSearchType::TwoOptSwap, LocalSearchType::IntraRoute})
+    {
+        for (int threads : {1, 8, 16, 32})
+        {
+            omp_set_num_threads(threads);
+            GeneticOptions options;
+            options.seed = 1;
+            options.recordHistory = false;
+            options.localSearch = engine;
+            auto timer = std::chrono::steady_clock::now();
+            auto result = geneticSolver(distMatrix, 10, 128, 50, 0.5f, StartingType::Random, options);
+            double seconds = secondsSince(timer);
+
+            std::cout << std::setw(12) << localSearchName(engine) << std::setw(10) << threads
+                      << std::setw(16) << std::fixed << std::setprecision(1) << result.generations / seconds << "\n";
+        }
+    }
+    omp_set_num_threads(defaultThreads);
+}
+
+int main(int argc, char **argv)
+{
+    const std::string name = argc > 1 ? argv[1] : "all";
+    bool ran = false;
+
+    if (name == "all" || name == "localsearch")
+    {
+        benchmarkLocalSearch();
+        ran = true;
+    }
+
+    if (name == "all" || name == "savings")
+    {
+        benchmarkSavings();
+        ran = true;
+    }
+
+    if (name == "all" || name == "islands")
+    {
+        benchmarkIslands();
+        ran = true;
+    }
+
+    if (name == "all" || name == "batch")
+    {
+        benchmarkBatch();
+        ran = true;
+    }
+
+    if (name == "all" || name == "storage")
+    {
+        benchmarkStorage();
+        ran = true;
+    }
+
+    if (name == "all" || name == "matrix")
+    {
+        benchmarkMatrix();
+        ran = true;
+    }
+
+    if (name == "all" || name == "reorder")
+    {
+        benchmarkReorder();
+        ran = true;
+    }
+
+    if (name == "all" || name == "decomposition")
+    {
+        benchmarkDecomposition();
+        ran = true;
+    }
+
+    if (name == "all" || name == "nn")
+    {
+        benchmarkNearestNeighbour();
+        ran = true;
+    }
+
+    if (name == "all" || name == "representation")
+    {
+        benchmarkRepresentation();
+        ran = true;
+    }
+
+    if (name == "all" || name == "crossover")
+    {
+        benchmarkCrossover();
+        ran = true;
+    }
+
+    if (name == "all" || name == "threads")
+    {
+        benchmarkThreads();
+        ran = true;
+    }
+
+    if (!ran)
+    {
+        std::cerr << "Unknown benchmark: " << name << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -1,10 +1,43 @@
 #include "api_solvers.h"
 #include "genetic_algorithm.h"
+#include "routes_progress.h"
+#include "solve_job.h"
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
+#include <optional>
+#include <string>
 
 namespace py = pybind11;
 
+// NumPy arrays of doubles are read in place, anything else (lists, other dtypes, strided views) is converted once
+using Coordinates = py::array_t<double, py::array::c_style | py::array::forcecast>;
+
+// Checks the shapes of the solver inputs and returns the number of customers.
+static size_t checkInputs(const Coordinates &customers_x, const Coordinates &customers_y, const std::optional<Coordinates> &distanceMatrix)
+{
+    if (customers_x.ndim() != 1 || customers_y.ndim() != 1 || customers_x.size() != customers_y.size())
+    {
+        throw std::invalid_argument("customers_x and customers_y must be 1-d and the same length.");
+    }
+    const py::ssize_t numLocations = customers_x.size() + 1;
+    if (distanceMatrix && (distanceMatrix->ndim() != 2 || distanceMatrix->shape(0) != numLocations || distanceMatrix->shape(1) != numLocations))
+    {
+        throw std::invalid_argument("distanceMatrix must have shape (" + std::to_string(numLocations) + ", " + std::to_string(numLocations) + ").");
+    }
+    return static_cast<size_t>(customers_x.size());
+}
+
+// Hands the vector to NumPy without copying it, the array owns it from then on.
+template <typename T>
+static py::array_t<T> toArray(std::vector<T> &&values)
+{
+    auto *owned = new std::vector<T>(std::move(values));
+    py::capsule owner(owned, [](void *pointer)
+                      { delete static_cast<std::vector<T> *>(pointer); });
+    return py::array_t<T>(owned->size(), owned->data(), owner);
+}
+
 // For accessing these functions in Python
 
 PYBIND11_MODULE(_vrp_core, m)
@@ -18,16 +51,263 @@ PYBIND11_MODULE(_vrp_core, m)
         .value("Mixed", StartingType::Mixed)
         .export_values();
 
-    m.def("completeSolverClarkeWright", &completeSolverClarkeWright,
+    py::enum_<LocalSearchType>(m, "LocalSearchType")
+        .value("TwoOptSwap", LocalSearchType::TwoOptSwap)
+        .value("IntraRoute", LocalSearchType::IntraRoute)
+        .value("IntraInterRoute", LocalSearchType::IntraInterRoute)
+        .export_values();
+
+    py::enum_<MigrationTopology>(m, "MigrationTopology")
+        .value("Ring", MigrationTopology::Ring)
+        .value("Random", MigrationTopology::Random); // Not exported, Random would clash with StartingType.Random
+
+    py::enum_<Representation>(m, "Representation")
+        .value("Routes", Representation::Routes)
+        .value("GiantTour", Representation::GiantTour)
+        .export_values();
+
+    py::enum_<MatrixStorage>(m, "MatrixStorage")
+        .value("Dense", MatrixStorage::Dense)
+        .value("Coordinates", MatrixStorage::Coordinates)
+        .value("PackedTriangular", MatrixStorage::PackedTriangular)
+        .value("Float32", MatrixStorage::Float32)
+        .value("FixedPoint", MatrixStorage::FixedPoint);
+
+    py::class_<IslandOptions>(m, "IslandOptions")
+        .def(py::init<>())
+        .def_readwrite("count", &IslandOptions::count)
+        .def_readwrite("migrationInterval", &IslandOptions::migrationInterval)
+        .def_readwrite("migrants", &IslandOptions::migrants)
+        .def_readwrite("topology", &IslandOptions::topology);
+
+    py::class_<GeneticOptions>(m, "GeneticOptions")
+        .def(py::init<>())
+        .def_readwrite("localSearch", &GeneticOptions::localSearch)
+        .def_readwrite("recordHistory", &GeneticOptions::recordHistory)
+        .def_readwrite("seed", &GeneticOptions::seed)
+        .def_readwrite("islands", &GeneticOptions::islands)
+        .def_readwrite("representation", &GeneticOptions::representation)
+        .def_readwrite("timeLimit", &GeneticOptions::timeLimit)
+        .def_readwrite("stallGenerations", &GeneticOptions::stallGenerations)
+        .def_readwrite("targetDistance", &GeneticOptions::targetDistance);
+
+    py::enum_<SubSolver>(m, "SubSolver")
+        .value("ClarkeWright", SubSolver::ClarkeWright)
+        .value("Genetic", SubSolver::Genetic); // Not exported, ClarkeWright would clash with StartingType.ClarkeWright
+
+    py::class_<DecompositionOptions>(m, "DecompositionOptions")
+        .def(py::init<>())
+        .def_readwrite("partitionSize", &DecompositionOptions::partitionSize)
+        .def_readwrite("windowRoutes", &DecompositionOptions::windowRoutes)
+        .def_readwrite("windowPasses", &DecompositionOptions::windowPasses)
+        .def_readwrite("subSolver", &DecompositionOptions::subSolver)
+        .def_readwrite("recordHistory", &DecompositionOptions::recordHistory)
+        .def_readwrite("numNeighbours", &DecompositionOptions::numNeighbours)
+        .def_readwrite("populationSize", &DecompositionOptions::populationSize)
+        .def_readwrite("generations", &DecompositionOptions::generations)
+        .def_readwrite("mutationProb", &DecompositionOptions::mutationProb)
+        .def_readwrite("startingType", &DecompositionOptions::startingType)
+        .def_readwrite("genetic", &DecompositionOptions::genetic);
+
+    py::enum_<StopReason>(m, "StopReason")
+        .value("MaxGenerations", StopReason::MaxGenerations)
+        .value("TimeLimit", StopReason::TimeLimit)
+        .value("Stalled", StopReason::Stalled)
+        .value("TargetReached", StopReason::TargetReached)
+        .value("Cancelled", StopReason::Cancelled);
+
+    py::class_<GeneticResult>(m, "GeneticResult")
+        .def_readonly("progress", &GeneticResult::progress)
+        .def_readonly("stopReason", &GeneticResult::stopReason)
+        .def_readonly("generations", &GeneticResult::generations);
+
+    // Frames are rebuilt when they are accessed, so iterating is cheaper than indexing every frame
+    py::class_<ProgressCursor>(m, "RoutesProgressIterator")
+        .def("__iter__", [](ProgressCursor &cursor) -> ProgressCursor &
+             { return cursor; })
+        .def("__next__", [](ProgressCursor &cursor)
+             {
+                 if (!cursor.next())
+                 {
+                     throw py::stop_iteration();
+                 }
+                 return cursor.routes(); });
+
+    py::class_<RoutesProgress>(m, "RoutesProgress")
+        .def("__len__", &RoutesProgress::size)
+        .def("__getitem__", [](const RoutesProgress &progress, long index)
+             {
+                 long size = static_cast<long>(progress.size());
+                 if (index < 0)
+                 {
+                     index += size;
+                 }
+                 if (index < 0 || index >= size)
+                 {
+                     throw py::index_error("progress index out of range");
+                 }
+                 return progress.frame(index); })
+        .def("__iter__", [](const RoutesProgress &progress)
+             { return ProgressCursor(progress); }, py::keep_alive<0, 1>())
+        .def("frames", &RoutesProgress::frames)
+        // Flat arrays instead of nested lists, see FlatFrames
+        .def("flatFrames", [](const RoutesProgress &progress)
+             {
+                 FlatFrames flat = progress.flatFrames();
+                 return py::make_tuple(toArray(std::move(flat.customers)), toArray(std::move(flat.routeOffsets)), toArray(std::move(flat.frameOffsets))); })
+        .def("flatRoutes", [](const RoutesProgress &progress, long index)
+             {
+                 long size = static_cast<long>(progress.size());
+                 if (index < 0)
+                 {
+                     index += size;
+                 }
+                 if (index < 0 || index >= size)
+                 {
+                     throw py::index_error("progress index out of range");
+                 }
+                 FlatFrames flat = progress.flatFrames(index, index + 1);
+                 return py::make_tuple(toArray(std::move(flat.customers)), toArray(std::move(flat.routeOffsets))); }, py::arg("index") = -1)
+        .def_property_readonly("recordsHistory", &RoutesProgress::recordsHistory);
+
+    // Waiting releases the GIL, so other Python threads keep running while a job is solving
+    py::class_<SolveJob, std::unique_ptr<SolveJob>>(m, "SolveJob")
+        .def("cancel", &SolveJob::cancel)
+        .def("done", &SolveJob::done)
+        .def("wait", &SolveJob::wait, py::call_guard<py::gil_scoped_release>())
+        .def("waitFor", &SolveJob::waitFor, py::arg("seconds"), py::call_guard<py::gil_scoped_release>())
+        .def("result", &SolveJob::result, py::return_value_policy::copy, py::call_guard<py::gil_scoped_release>())
+        .def_property_readonly("generation", &SolveJob::generation)
+        .def_property_readonly("bestDistance", &SolveJob::bestDistance);
+
+    // The coordinates and distanceMatrix are read in place, and the solvers run without the GIL once they are checked
+    m.def("completeSolverClarkeWright", [](const double depot_x, const double depot_y, const Coordinates &customers_x, const Coordinates &customers_y,
+                                           const size_t maxPackages, const bool exportData, const std::string &fileName, const size_t numNeighbours,
+                                           const bool recordHistory, const std::optional<Coordinates> &distanceMatrix, const MatrixStorage matrixStorage,
+                                           const bool reorder)
+          {
+              const size_t numCustomers = checkInputs(customers_x, customers_y, distanceMatrix);
+              py::gil_scoped_release release;
+              return completeSolverClarkeWright(depot_x, depot_y, customers_x.data(), customers_y.data(), numCustomers,
+                                                distanceMatrix ? distanceMatrix->data() : nullptr,
+                                                maxPackages, exportData, fileName, numNeighbours, recordHistory, matrixStorage, reorder); },
+          py::arg("depot_x"),
+          py::arg("depot_y"),
+          py::arg("customers_x"),
+          py::arg("customers_y"),
+          py::arg("maxPackages"),
+          py::arg("exportData"),
+          py::arg("fileName") = "",
+          py::arg("numNeighbours") = 0,
+          py::arg("recordHistory") = true,
+          py::arg("distanceMatrix") = py::none(),
+          py::arg("matrixStorage") = MatrixStorage::Dense,
+          py::arg("reorder") = false);
+
+    m.def("completeSolverGenetic", [](const double depot_x, const double depot_y, const Coordinates &customers_x, const Coordinates &customers_y,
+                                      const size_t maxPackages, const size_t populationSize, const size_t generations, const float mutationProb,
+                                      const bool exportData, const StartingType startingType, const std::string &fileName,
+                                      const GeneticOptions &options, const std::optional<Coordinates> &distanceMatrix, const MatrixStorage matrixStorage,
+                                      const bool reorder)
+          {
+              const size_t numCustomers = checkInputs(customers_x, customers_y, distanceMatrix);
+              py::gil_scoped_release release;
+              return completeSolverGenetic(depot_x, depot_y, customers_x.data(), customers_y.data(), numCustomers,
+                                           distanceMatrix ? distanceMatrix->data() : nullptr,
+                                           maxPackages, populationSize, generations, mutationProb, exportData, startingType, fileName, options, matrixStorage, reorder); },
+          py::arg("depot_x"),
+          py::arg("depot_y"),
+          py::arg("customers_x"),
+          py::arg("customers_y"),
+          py::arg("maxPackages"),
+          py::arg("populationSize"),
+          py::arg("generations"),
+          py::arg("mutationProb"),
+          py::arg("exportData"),
+          py::arg("startingType") = StartingType::ClarkeWright,
+          py::arg("fileName") = "",
+          py::arg("options") = GeneticOptions(),
+          py::arg("distanceMatrix") = py::none(),
+          py::arg("matrixStorage") = MatrixStorage::Dense,
+          py::arg("reorder") = false);
+
+    py::class_<BatchInstance>(m, "BatchInstance")
+        .def(py::init([](const double depot_x, const double depot_y, std::vector<double> customers_x, std::vector<double> customers_y, const size_t maxPackages)
+                      { return BatchInstance{depot_x, depot_y, std::move(customers_x), std::move(customers_y), maxPackages}; }),
+             py::arg("depot_x"),
+             py::arg("depot_y"),
+             py::arg("customers_x"),
+             py::arg("customers_y"),
+             py::arg("maxPackages"))
+        .def_readwrite("depot_x", &BatchInstance::depot_x)
+        .def_readwrite("depot_y", &BatchInstance::depot_y)
+        .def_readwrite("customers_x", &BatchInstance::customers_x)
+        .def_readwrite("customers_y", &BatchInstance::customers_y)
+        .def_readwrite("maxPackages", &BatchInstance::maxPackages);
+
+    py::class_<BatchResult<RoutesProgress>>(m, "ClarkeWrightBatchResult")
+        .def_readonly("results", &BatchResult<RoutesProgress>::results)
+        .def_readonly("seconds", &BatchResult<RoutesProgress>::seconds)
+        .def_readonly("instancesPerSecond", &BatchResult<RoutesProgress>::instancesPerSecond);
+
+    py::class_<BatchResult<GeneticResult>>(m, "GeneticBatchResult")
+        .def_readonly("results", &BatchResult<GeneticResult>::results)
+        .def_readonly("seconds", &BatchResult<GeneticResult>::seconds)
+        .def_readonly("instancesPerSecond", &BatchResult<GeneticResult>::instancesPerSecond);
+
+    m.def("completeSolverClarkeWrightBatch", &completeSolverClarkeWrightBatch,
+          py::call_guard<py::gil_scoped_release>(),
+          py::arg("instances"),
+          py::arg("numNeighbours") = 0,
+          py::arg("recordHistory") = false,
+          py::arg("largeInstanceSize") = 1000);
+
+    m.def("completeSolverGeneticBatch", &completeSolverGeneticBatch,
+          py::call_guard<py::gil_scoped_release>(),
+          py::arg("instances"),
+          py::arg("populationSize"),
+          py::arg("generations"),
+          py::arg("mutationProb"),
+          py::arg("startingType") = StartingType::ClarkeWright,
+          py::arg("options") = GeneticOptions(),
+          py::arg("largeInstanceSize") = 1000);
+
+    m.def("completeSolverDecomposed", [](const double depot_x, const double depot_y, const Coordinates &customers_x, const Coordinates &customers_y,
+                                         const size_t maxPackages, const bool exportData, const std::string &fileName, const DecompositionOptions &options,
+                                         const std::optional<Coordinates> &distanceMatrix, const MatrixStorage matrixStorage)
+          {
+              const size_t numCustomers = checkInputs(customers_x, customers_y, distanceMatrix);
+              py::gil_scoped_release release;
+              return completeSolverDecomposed(depot_x, depot_y, customers_x.data(), customers_y.data(), numCustomers,
+                                              distanceMatrix ? distanceMatrix->data() : nullptr,
+                                              maxPackages, exportData, fileName, options, matrixStorage); },
           py::arg("depot_x"),
           py::arg("depot_y"),
           py::arg("customers_x"),
           py::arg("customers_y"),
           py::arg("maxPackages"),
           py::arg("exportData"),
-          py::arg("fileName") = "");
+          py::arg("fileName") = "",
+          py::arg("options") = DecompositionOptions(),
+          py::arg("distanceMatrix") = py::none(),
+          py::arg("matrixStorage") = MatrixStorage::Coordinates);
 
-    m.def("completeSolverGenetic", &completeSolverGenetic,
+    // The job outlives the call, so it keeps its own copy of the inputs
+    m.def("startSolverGenetic", [](const double depot_x, const double depot_y, const Coordinates &customers_x, const Coordinates &customers_y,
+                                   const size_t maxPackages, const size_t populationSize, const size_t generations, const float mutationProb,
+                                   const bool exportData, const StartingType startingType, const std::string &fileName,
+                                   const GeneticOptions &options, const std::optional<Coordinates> &distanceMatrix)
+          {
+              const size_t numCustomers = checkInputs(customers_x, customers_y, distanceMatrix);
+              std::vector<double> xs(customers_x.data(), customers_x.data() + numCustomers);
+              std::vector<double> ys(customers_y.data(), customers_y.data() + numCustomers);
+              std::vector<double> distances;
+              if (distanceMatrix)
+              {
+                  distances.assign(distanceMatrix->data(), distanceMatrix->data() + distanceMatrix->size());
+              }
+              return startSolverGenetic(depot_x, depot_y, xs, ys, maxPackages, populationSize, generations, mutationProb,
+                                        exportData, startingType, fileName, options, distances); },
           py::arg("depot_x"),
           py::arg("depot_y"),
           py::arg("customers_x"),
@@ -38,5 +318,7 @@ PYBIND11_MODULE(_vrp_core, m)
           py::arg("mutationProb"),
           py::arg("exportData"),
           py::arg("startingType") = StartingType::ClarkeWright,
-          py::arg("fileName") = "");
+          py::arg("fileName") = "",
+          py::arg("options") = GeneticOptions(),
+          py::arg("distanceMatrix") = py::none());
 }
\ No newline at end of file
@@ -1,212 +1,435 @@
 #include "clarke_wright.h"
 #include "utils.h"
+#include "spatial_index.h"
+#include "routes_progress.h"
 #include <vector>
 #include <tuple>
 #include <algorithm>
-#include <unordered_map>
+#include <array>
 #include <utility>
+#include <cstdint>
+#include <cstring>
+#include <omp.h>
 
 /* Clarke-Wright algorithm
-    - Returns a final version of the routes and a vector of the routes at each step of the algorithm.
+    - Returns a final version of the routes and the progress of the routes over the steps of the algorithm. With
+      recordHistory false the progress only holds the final routes.
     - Steps:
     1. Pretend every location is in its own route.
     2. Create savings list and order by descending savings amounts. One entry consists of two locations and the savings that would come from joining them.
+       This is done in parallel by getSavings and sortSavings.
     3. Iterate through sorted savings list and do one of three things as long it does not create a route with more locations than maxPackages:
         - If both points i and j have not been included in a route create a new route by connecting them
         - If only one of i or j has been included in a route and it is not in the interior of the route, the link i-j will be added to the route
         - If both i and j have been included in a route and they are both not interior points, connect their routes
     4. Any points not included in a route create their own route that consists of only that point.
     5. Add the depot to the beginning and ending of each route.
+    - With numNeighbours > 0 the savings list only holds pairs where one customer is among the numNeighbours closest
+      customers of the other (granular neighbour lists), so it has O(n * numNeighbours) entries instead of O(n^2).
+      Depot edges need no candidates of their own, every customer starts on a route to the depot and step 4 keeps
+      the ones that were never joined.
 */
-std::pair<std::vector<std::vector<int>>, std::vector<std::vector<std::vector<int>>>>
-clarkeWrightSolver(const Matrix &distMatrix, const size_t maxPackages)
+std::pair<std::vector<std::vector<int>>, RoutesProgress>
+clarkeWrightSolver(const Matrix &distMatrix, const size_t maxPackages, const size_t numNeighbours, const bool recordHistory)
 {
     // 1. & 2.
-    std::vector<std::tuple<int, int, double>> savings;
+    std::vector<Saving> savings = getSavings(distMatrix, numNeighbours);
+    sortSavings(savings);
 
-    size_t numLocations = distMatrix.rows.size();
-    for (int i = 1; i < numLocations; i++)
+    // Steps 3-5 are done in ProcessSavings
+    int numCustomers = distMatrix.size() - 1; // minus the one depot
+    auto [routes, routesProgress] = processSavings(savings, numCustomers, maxPackages, recordHistory);
+
+    return {std::move(routes), std::move(routesProgress)};
+}
+
+/* Savings list (step 2 without the sort)
+    - Every customer's row is written to its own range of the list, so the rows are filled in parallel and the list is
+      in the same order whatever the number of threads: by i, then by j (full list) or neighbour rank (granular).
+    - Without neighbour lists row i holds the pairs (i, j > i) and starts after the rows before it.
+    - With neighbour lists each row is counted first, pairs that are in each other's lists are only kept in the row of
+      the lower index.
+*/
+std::vector<Saving> getSavings(const Matrix &distMatrix, const size_t numNeighbours)
+{
+    const int numLocations = static_cast<int>(distMatrix.size());
+    if (numLocations < 3)
     {
-        for (int j = i + 1; j < numLocations; j++)
+        return {};
+    }
+    const size_t numCustomers = numLocations - 1;
+    std::vector<double> depotBuffer(numLocations);
+    const double *depotRow = distMatrix.row(0, 0, numLocations, depotBuffer.data());
+    std::vector<Saving> savings;
+
+    if (numNeighbours == 0 || numNeighbours + 2 >= static_cast<size_t>(numLocations))
+    {
+        savings.resize(numCustomers * (numCustomers - 1) / 2);
+#pragma omp parallel
         {
-            double saving = distMatrix.rows[0][i] + distMatrix.rows[0][j] - distMatrix.rows[i][j];
-            savings.emplace_back(i, j, saving);
+            std::vector<double> buffer(numLocations);
+#pragma omp for schedule(dynamic, 16)
+            for (int i = 1; i < numLocations; i++)
+            {
+                // Distances to j > i, starting at index 0
+                const double *row = distMatrix.row(i, i + 1, numLocations, buffer.data());
+                Saving *saving = savings.data() + (i - 1) * (2 * numCustomers - i) / 2;
+                for (int j = i + 1; j < numLocations; j++)
+                {
+                    *saving++ = {static_cast<float>(depotRow[i] + depotRow[j] - row[j - i - 1]), static_cast<std::uint32_t>(i), static_cast<std::uint32_t>(j)};
+                }
+            }
         }
+        return savings;
     }
 
-    std::sort(savings.begin(), savings.end(), [](const auto &a, const auto &b)
-              { return std::get<2>(a) > std::get<2>(b); });
+    std::vector<int> neighbours = getNeighbourLists(distMatrix, numNeighbours);
+    auto isNeighbour = [&](int of, int candidate)
+    {
+        auto first = neighbours.begin() + (of - 1) * numNeighbours;
+        return std::find(first, first + numNeighbours, candidate) != first + numNeighbours;
+    };
 
-    // Steps 3-5 are done in ProcessSavings
-    int numCustomers = numLocations - 1; // minus the one depot
-    auto [routes, routesProgress] = processSavings(savings, numCustomers, maxPackages);
+    std::vector<unsigned char> keep(neighbours.size());
+    std::vector<size_t> rowStart(numLocations + 1, 0);
+#pragma omp parallel for schedule(static)
+    for (int i = 1; i < numLocations; i++)
+    {
+        size_t count = 0;
+        for (size_t k = 0; k < numNeighbours; k++)
+        {
+            size_t index = (i - 1) * numNeighbours + k;
+            int j = neighbours[index];
+            keep[index] = !(j < i && isNeighbour(j, i));
+            count += keep[index];
+        }
+        rowStart[i + 1] = count;
+    }
+    for (int i = 1; i < numLocations; i++)
+    {
+        rowStart[i + 1] += rowStart[i];
+    }
 
-    return {routes, routesProgress};
+    savings.resize(rowStart[numLocations]);
+#pragma omp parallel for schedule(static)
+    for (int i = 1; i < numLocations; i++)
+    {
+        Saving *saving = savings.data() + rowStart[i];
+        for (size_t k = 0; k < numNeighbours; k++)
+        {
+            size_t index = (i - 1) * numNeighbours + k;
+            if (!keep[index])
+            {
+                continue;
+            }
+            int low = std::min(i, neighbours[index]);
+            int high = std::max(i, neighbours[index]);
+            *saving++ = {static_cast<float>(depotRow[low] + depotRow[high] - distMatrix(low, high)), static_cast<std::uint32_t>(low), static_cast<std::uint32_t>(high)};
+        }
+    }
+    return savings;
 }
 
-std::pair<std::vector<std::vector<int>>, std::vector<std::vector<std::vector<int>>>>
-processSavings(const std::vector<std::tuple<int, int, double>> &savings, const size_t numCustomers, const size_t maxPackages)
+// Maps a saving to an unsigned key that orders the same way as the saving, largest first.
+// Positive floats order like their bits, negative floats in reverse, with the sign bit making them smaller.
+static std::uint32_t descendingKey(const float saving)
 {
-    std::vector<std::vector<int>> routes;
-    std::vector<std::vector<std::vector<int>>> routesProgress;
-    std::vector<bool> isEdgePoint(numCustomers + 1, false);
-    std::unordered_map<int, int> pointToRoute; // Maps a point index to its route index
+    std::uint32_t bits;
+    std::memcpy(&bits, &saving, sizeof(bits));
+    return (bits & 0x80000000u) ? bits : bits ^ 0x7FFFFFFFu;
+}
 
-    // 3.
-    for (const auto &s : savings)
+/* Sorts the savings from largest to smallest
+    - Parallel LSD radix sort on the 32-bit key, one byte per pass. It is stable, so equal savings stay in the order
+      getSavings wrote them and the routes do not depend on the number of threads.
+    - Every thread counts the digits of its own slice, the counts are turned into one start position per digit and
+      thread, then every thread moves its slice. A pass where all keys share the digit is skipped.
+    - Needs one buffer the size of the list, which is freed before returning.
+*/
+void sortSavings(std::vector<Saving> &savings)
+{
+    const size_t size = savings.size();
+    if (size < 2)
     {
-        int i = std::get<0>(s);
-        int j = std::get<1>(s);
-
-        // Neither in route
-        if (pointToRoute.find(i) == pointToRoute.end() && pointToRoute.find(j) == pointToRoute.end())
-        {
-            std::vector<int> newRoute = {i, j};
-            int routeIndex = routes.size();
-            routes.push_back(newRoute);
+        return;
+    }
 
-            pointToRoute[i] = routeIndex;
-            pointToRoute[j] = routeIndex;
+    const size_t numBuckets = 256;
+    std::vector<Saving> buffer(size);
+    std::vector<size_t> counts;
+    Saving *from = savings.data();
+    Saving *to = buffer.data();
+    bool skipPass = false;
 
-            isEdgePoint[i] = true;
-            isEdgePoint[j] = true;
+#pragma omp parallel
+    {
+        const size_t numThreads = omp_get_num_threads();
+        const size_t thread = omp_get_thread_num();
+        const size_t begin = size * thread / numThreads;
+        const size_t end = size * (thread + 1) / numThreads;
 
-            routesProgress.push_back(routes);
-        }
+#pragma omp single
+        counts.assign(numThreads * numBuckets, 0);
 
-        // One (at index i) is an edge point and other point is not in a route and the route is less than the max length
-        else if (isEdgePoint[i] && pointToRoute.find(j) == pointToRoute.end() && routes[pointToRoute[i]].size() != maxPackages)
+        for (int shift = 0; shift < 32; shift += 8)
         {
-            std::vector<int> &route = routes[pointToRoute[i]];
+            size_t *count = counts.data() + thread * numBuckets;
+            std::fill(count, count + numBuckets, 0);
+            for (size_t i = begin; i < end; ++i)
+            {
+                count[(descendingKey(from[i].saving) >> shift) & 0xFF]++;
+            }
+#pragma omp barrier
+
+#pragma omp single
+            {
+                // Digit d of thread t starts after all smaller digits and after digit d of the threads before t
+                size_t offset = 0;
+                skipPass = false;
+                for (size_t digit = 0; digit < numBuckets; ++digit)
+                {
+                    size_t digitStart = offset;
+                    for (size_t t = 0; t < numThreads; ++t)
+                    {
+                        size_t digitCount = counts[t * numBuckets + digit];
+                        counts[t * numBuckets + digit] = offset;
+                        offset += digitCount;
+                    }
+                    skipPass = skipPass || offset - digitStart == size;
+                }
+            }
 
-            if (route.front() == i)
+            if (!skipPass)
             {
-                route.insert(route.begin(), j);
+                for (size_t i = begin; i < end; ++i)
+                {
+                    to[count[(descendingKey(from[i].saving) >> shift) & 0xFF]++] = from[i];
+                }
             }
-            else if (route.back() == i)
+#pragma omp barrier
+
+#pragma omp single
+            if (!skipPass)
             {
-                route.push_back(j);
+                std::swap(from, to);
             }
+        }
+    }
 
-            isEdgePoint[i] = false;
-            isEdgePoint[j] = true;
-            pointToRoute[j] = pointToRoute[i];
+    if (from != savings.data())
+    {
+        savings.swap(buffer);
+    }
+}
+
+/* Steps 3-5 of the Clarke-Wright algorithm
+    - Every route is a chain of customers where each customer knows its (at most two) neighbours in links, so adding
+      a customer or joining two routes only touches the customers at the joint, and a route never has to be reversed.
+    - Routes are numbered in the order they are created. When two routes join, the lower number survives, which keeps
+      the routes in the same order as keeping them in one vector and erasing the joined one would.
+    - routeOf maps a customer to the number of the route it was added to. Joined routes point to the route they joined
+      in routeParent (union-find), so looking up the current route of a customer is O(1) amortised.
+    - The routes are only written out as vectors at the end. Each step is recorded in the progress as one small event
+      (RoutesProgress numbers routes the same way), so the history is O(n) instead of one copy of all routes per step.
+*/
+std::pair<std::vector<std::vector<int>>, RoutesProgress>
+processSavings(const std::vector<Saving> &savings, const size_t numCustomers, const size_t maxPackages, const bool recordHistory)
+{
+    const int noRoute = -1;
+    const int noLink = 0; // Customers are numbered from 1, so 0 can mark a missing neighbour
+
+    RoutesProgress routesProgress(recordHistory);
+    std::vector<bool> isEdgePoint(numCustomers + 1, false);
+    std::vector<std::array<int, 2>> links(numCustomers + 1, {noLink, noLink});
+    std::vector<int> routeOf(numCustomers + 1, noRoute);
 
-            routesProgress.push_back(routes);
+    // Per route, indexed by route number. A customer never starts more than one route.
+    std::vector<int> routeParent;
+    std::vector<int> routeHead;
+    std::vector<int> routeTail;
+    std::vector<size_t> routeSize;
+    std::vector<bool> routeAlive;
+    routeParent.reserve(numCustomers);
+    routeHead.reserve(numCustomers);
+    routeTail.reserve(numCustomers);
+    routeSize.reserve(numCustomers);
+    routeAlive.reserve(numCustomers);
+
+    auto findRoute = [&](int point)
+    {
+        int route = routeOf[point];
+        if (route == noRoute)
+        {
+            return noRoute;
         }
+        while (routeParent[route] != route)
+        {
+            routeParent[route] = routeParent[routeParent[route]];
+            route = routeParent[route];
+        }
+        return route;
+    };
+
+    auto newRoute = [&](int head, int tail, size_t size)
+    {
+        int route = routeParent.size();
+        routeParent.push_back(route);
+        routeHead.push_back(head);
+        routeTail.push_back(tail);
+        routeSize.push_back(size);
+        routeAlive.push_back(true);
+        return route;
+    };
 
-        // One (at index j) is an edge point and other point is not in a route and the route is less than the max length
-        else if (isEdgePoint[j] && pointToRoute.find(i) == pointToRoute.end() && routes[pointToRoute[j]].size() != maxPackages)
+    auto link = [&](int a, int b)
+    {
+        links[a][links[a][0] == noLink ? 0 : 1] = b;
+        links[b][links[b][0] == noLink ? 0 : 1] = a;
+    };
+
+    // Writes out the routes in route number order, with the depot at both ends (step 5)
+    auto materialiseRoutes = [&]()
+    {
+        std::vector<std::vector<int>> routes;
+        for (size_t route = 0; route < routeHead.size(); ++route)
         {
-            std::vector<int> &route = routes[pointToRoute[j]];
-            if (route.front() == j)
+            if (!routeAlive[route])
             {
-                route.insert(route.begin(), i);
+                continue;
             }
-            else if (route.back() == j)
+            std::vector<int> points = {0};
+            points.reserve(routeSize[route] + 2);
+            int previous = noLink;
+            int current = routeHead[route];
+            while (current != noLink)
             {
-                route.push_back(i);
+                points.push_back(current);
+                int next = links[current][0] != previous ? links[current][0] : links[current][1];
+                previous = current;
+                current = next;
             }
+            points.push_back(0);
+            routes.push_back(std::move(points));
+        }
+        return routes;
+    };
+
+    // 3.
+    for (const auto &s : savings)
+    {
+        int i = s.i;
+        int j = s.j;
+        int routeI = findRoute(i);
+        int routeJ = findRoute(j);
+
+        // Neither in route
+        if (routeI == noRoute && routeJ == noRoute)
+        {
+            int route = newRoute(i, j, 2);
+            link(i, j);
+            routeOf[i] = route;
+            routeOf[j] = route;
 
-            isEdgePoint[j] = false;
             isEdgePoint[i] = true;
-            pointToRoute[i] = pointToRoute[j];
+            isEdgePoint[j] = true;
 
-            routesProgress.push_back(routes);
+            routesProgress.newRoute(i, j);
         }
 
-        // Both are end points and they are on different routes and combining them will not violate max route length
-        else if (isEdgePoint[i] && isEdgePoint[j] &&
-                 pointToRoute[i] != pointToRoute[j] &&
-                 routes[pointToRoute[i]].size() + routes[pointToRoute[j]].size() <= maxPackages)
+        // One is an edge point and other point is not in a route and the route is less than the max length
+        else if ((isEdgePoint[i] && routeJ == noRoute && routeSize[routeI] != maxPackages) ||
+                 (isEdgePoint[j] && routeI == noRoute && routeSize[routeJ] != maxPackages))
         {
-            int routeIndexI = pointToRoute[i];
-            int routeIndexJ = pointToRoute[j];
-
-            // Make routeI the one with the smaller index
-            if (routeIndexI > routeIndexJ)
+            // Make i the edge point
+            if (routeJ != noRoute)
             {
-                std::swap(routeIndexI, routeIndexJ);
                 std::swap(i, j);
+                std::swap(routeI, routeJ);
             }
 
-            std::vector<int> &routeI = routes[routeIndexI];
-            std::vector<int> &routeJ = routes[routeIndexJ];
-
-            // Combine vectors, reverse if i and j are both at the front or both at the back
-            if (routeI.front() == i)
+            if (routeHead[routeI] == i)
             {
-                if (routeJ.front() == j)
-                {
-                    std::reverse(routeJ.begin(), routeJ.end());
-                    routeI.insert(routeI.begin(), routeJ.begin(), routeJ.end());
-                }
-                else if (routeJ.back() == j)
-                {
-                    routeI.insert(routeI.begin(), routeJ.begin(), routeJ.end());
-                }
+                routeHead[routeI] = j;
+                routesProgress.addToFront(routeI, j);
             }
-            else if (routeI.back() == i)
+            else if (routeTail[routeI] == i)
             {
-                if (routeJ.front() == j)
-                {
-                    routeI.insert(routeI.end(), routeJ.begin(), routeJ.end());
-                }
-                else if (routeJ.back() == j)
-                {
-                    std::reverse(routeJ.begin(), routeJ.end());
-                    routeI.insert(routeI.end(), routeJ.begin(), routeJ.end());
-                }
+                routeTail[routeI] = j;
+                routesProgress.addToBack(routeI, j);
             }
+            link(i, j);
+            routeSize[routeI]++;
 
             isEdgePoint[i] = false;
-            isEdgePoint[j] = false;
+            isEdgePoint[j] = true;
+            routeOf[j] = routeI;
+        }
 
-            // Update the pointToRoute indices
-            for (int point : routeJ)
+        // Both are end points and they are on different routes and combining them will not violate max route length
+        else if (isEdgePoint[i] && isEdgePoint[j] &&
+                 routeI != routeJ &&
+                 routeSize[routeI] + routeSize[routeJ] <= maxPackages)
+        {
+            // Make routeI the one that was created first, it is the one that is kept
+            if (routeI > routeJ)
             {
-                pointToRoute[point] = routeIndexI;
+                std::swap(routeI, routeJ);
+                std::swap(i, j);
             }
 
-            routes.erase(routes.begin() + routeIndexJ);
-            for (int row = routeIndexJ; row < routes.size(); row++)
+            // The joined route runs from the far end of one route to the far end of the other.
+            // routeI keeps its direction, except when i is at its front: then routeJ comes first.
+            // routeJ is reversed when that puts j next to i.
+            bool joinedFirst = routeHead[routeI] == i;
+            routesProgress.join(routeI, routeJ, joinedFirst, joinedFirst ? routeHead[routeJ] == j : routeTail[routeJ] == j);
+            if (joinedFirst)
             {
-                for (int point : routes[row])
-                {
-                    pointToRoute[point] = row;
-                }
+                routeHead[routeI] = (routeHead[routeJ] == j) ? routeTail[routeJ] : routeHead[routeJ];
             }
+            else
+            {
+                routeTail[routeI] = (routeHead[routeJ] == j) ? routeTail[routeJ] : routeHead[routeJ];
+            }
+            link(i, j);
+            routeSize[routeI] += routeSize[routeJ];
+            routeParent[routeJ] = routeI;
+            routeAlive[routeJ] = false;
 
-            routesProgress.push_back(routes);
+            isEdgePoint[i] = false;
+            isEdgePoint[j] = false;
         }
     }
 
     // 4.
-    for (int i = 1; i <= numCustomers; i++)
+    for (size_t i = 1; i <= numCustomers; i++)
     {
-        if (pointToRoute.find(i) == pointToRoute.end())
+        if (routeOf[i] == noRoute)
         {
-            std::vector<int> newRoute = {i};
-            routes.push_back(newRoute);
-            routesProgress.push_back(routes);
+            const int customer = static_cast<int>(i);
+            routeOf[i] = newRoute(customer, customer, 1);
+            routesProgress.newRoute(customer);
         }
     }
 
-    // 5.
-    for (auto &route : routes)
+    // 5. (the depot is added as the routes are written out)
+    std::vector<std::vector<int>> routes = materialiseRoutes();
+    if (!recordHistory)
     {
-        route.insert(route.begin(), 0);
-        route.push_back(0);
+        routesProgress.keyframe(routes);
     }
+    return {std::move(routes), std::move(routesProgress)};
+}
 
-    for (auto &routes : routesProgress)
+// Same as above for a savings list of (i, j, saving) tuples sorted by descending saving.
+std::pair<std::vector<std::vector<int>>, RoutesProgress>
+processSavings(const std::vector<std::tuple<int, int, double>> &savings, const size_t numCustomers, const size_t maxPackages,
+               const bool recordHistory)
+{
+    std::vector<Saving> packed;
+    packed.reserve(savings.size());
+    for (const auto &[i, j, saving] : savings)
     {
-        for (auto &route : routes)
-        {
-            route.insert(route.begin(), 0);
-            route.push_back(0);
-        }
+        packed.push_back({static_cast<float>(saving), static_cast<std::uint32_t>(i), static_cast<std::uint32_t>(j)});
     }
-
-    return {routes, routesProgress};
-}
\ No newline at end of file
+    return processSavings(packed, numCustomers, maxPackages, recordHistory);
+}
@@ -1,191 +1,427 @@
 #include "create_child.h"
 #include "genetic_algo_utils.h"
+#include "local_search.h"
+#include "utils.h"
+#include "epoch_marks.h"
 #include <vector>
 #include <algorithm>
-#include <random>
-#include <unordered_set>
-struct Matrix;
+#include <stdexcept>
 
-Individual createChild(const std::vector<Individual> &parents, const size_t maxPackages, const float mutationProb, const Matrix &distMatrix)
+/* Creates one child of first and second in child
+    - child is an individual of the population that is being replaced, its route vectors are reused.
+    - Together with the per-thread route pool this means no memory is allocated for a child once the pools are warm.
+*/
+void createChild(const Individual &first, const Individual &second, Individual &child, const size_t maxPackages, const float mutationProb, const Matrix &distMatrix, Rng &rng, const LocalSearchType localSearch)
 {
-    Individual child;
-    Individual parentA;
-    Individual parentB;
-    if (parents[0].total_distance < parents[1].total_distance)
+    // parentA is the fitter parent, the parents are only read so they are not copied
+    const bool firstIsFitter = first.total_distance < second.total_distance;
+    const Individual &parentA = firstIsFitter ? first : second;
+    const Individual &parentB = firstIsFitter ? second : first;
+
+    routeCrossover(parentA, parentB, maxPackages, distMatrix, child);
+    mutation(child, mutationProb, maxPackages, distMatrix, rng);
+    switch (localSearch)
+    {
+    case LocalSearchType::TwoOptSwap:
+        twoOptSwap(child, distMatrix);
+        break;
+    case LocalSearchType::IntraRoute:
+        intraRouteSearch(child, distMatrix);
+        break;
+    case LocalSearchType::IntraInterRoute:
+        interRouteSearch(child, distMatrix, maxPackages);
+        break;
+    default:
+        throw std::invalid_argument("Local search type must be TwoOptSwap, IntraRoute or IntraInterRoute");
+    }
+    // Every step kept the lengths of the routes it changed, so the total is only added up again
+    updateTotalDistance(child);
+}
+
+// The best merge found for route, with partner: route first then partner when routeFirst, partner first otherwise.
+// The versions say which contents of the two routes it was found for, so an entry is stale once either of them changes.
+struct MergeCandidate
+{
+    double saving;
+    unsigned int route;
+    unsigned int partner;
+    unsigned int routeVersion;
+    unsigned int partnerVersion;
+    bool routeFirst;
+};
+
+// Heap order: the largest saving on top, then the lowest route numbers, so equal savings merge in a fixed order.
+static bool mergesLater(const MergeCandidate &a, const MergeCandidate &b)
+{
+    if (a.saving != b.saving)
+    {
+        return a.saving < b.saving;
+    }
+    const unsigned int lowA = std::min(a.route, a.partner);
+    const unsigned int lowB = std::min(b.route, b.partner);
+    if (lowA != lowB)
+    {
+        return lowA > lowB;
+    }
+    return std::max(a.route, a.partner) > std::max(b.route, b.partner);
+}
+
+/* Savings merge of the routes of a child
+    - Joining route first to route second replaces the edges last(first) -> depot and depot -> first(second) by the
+      edge between them, which saves d(last, 0) + d(0, first) - d(last, first). Both orders of a pair are scored and
+      the better one counts. Two routes fit together when their customers fit in maxPackages - 2.
+    - The heap holds the best merge of every route. The best one is merged while it saves distance: the merged route
+      takes the slot of the lower numbered route and only it looks for a new best merge. An entry whose partner
+      changed is only found again when it comes to the top of the heap, so every merge costs O(R log R) for R routes,
+      where restarting the scan over all pairs after every merge was O(R^3) or worse.
+    - Merges the same pairs as trying the best of all pairs every time, since an entry that is not stale is the best
+      merge of its route and routes only lose partners, apart from the merged route itself.
+    - The routes that were not merged keep their order and the merged ones follow in the order they were last merged.
+*/
+template <typename Distances>
+static void mergeRoutes(std::vector<std::vector<int>> &routes, std::vector<double> &lengths, const size_t maxPackages, const Distances &d)
+{
+    thread_local std::vector<MergeCandidate> heap;
+    thread_local std::vector<unsigned int> version;
+    thread_local std::vector<size_t> lastMerge;
+    thread_local std::vector<size_t> order;
+    thread_local std::vector<std::vector<int>> reordered;
+    thread_local std::vector<double> reorderedLengths;
+    thread_local std::vector<int> firstOf;
+    thread_local std::vector<int> lastOf;
+    thread_local std::vector<double> fromDepot;
+    thread_local std::vector<double> toDepot;
+
+    const size_t numRoutes = routes.size();
+    heap.clear();
+    version.assign(numRoutes, 0);
+    lastMerge.assign(numRoutes, 0);
+    firstOf.resize(numRoutes);
+    lastOf.resize(numRoutes);
+    fromDepot.resize(numRoutes);
+    toDepot.resize(numRoutes);
+
+    // The ends of every route and their edges to the depot, so scoring a pair reads two distances
+    auto setEnds = [&](const size_t r)
+    {
+        firstOf[r] = routes[r][1];
+        lastOf[r] = routes[r][routes[r].size() - 2];
+        fromDepot[r] = d(0, firstOf[r]);
+        toDepot[r] = d(lastOf[r], 0);
+    };
+    auto saving = [&](const size_t first, const size_t second)
+    {
+        return toDepot[first] + fromDepot[second] - d(lastOf[first], firstOf[second]);
+    };
+    // Adds the best merge of route r that saves anything, ties go to the lowest numbered partner
+    auto addBest = [&](const size_t r)
+    {
+        MergeCandidate best = {0.0, static_cast<unsigned int>(r), 0, version[r], 0, true};
+        bool found = false;
+        for (size_t other = 0; other < numRoutes; ++other)
+        {
+            if (other == r || routes[other].empty() || routes[r].size() + routes[other].size() > maxPackages + 2)
+            {
+                continue;
+            }
+            const double forward = saving(r, other);
+            const double backward = saving(other, r);
+            const double better = std::max(forward, backward);
+            if (better > best.saving)
+            {
+                best.saving = better;
+                best.partner = static_cast<unsigned int>(other);
+                best.partnerVersion = version[other];
+                best.routeFirst = forward >= backward;
+                found = true;
+            }
+        }
+        if (found)
+        {
+            heap.push_back(best);
+        }
+        return found;
+    };
+
+    for (size_t r = 0; r < numRoutes; ++r)
+    {
+        setEnds(r);
+    }
+    for (size_t r = 0; r < numRoutes; ++r)
+    {
+        addBest(r);
+    }
+    std::make_heap(heap.begin(), heap.end(), mergesLater);
+
+    size_t merges = 0;
+    while (!heap.empty())
     {
-        parentA = parents[0];
-        parentB = parents[1];
+        const MergeCandidate best = heap.front();
+        std::pop_heap(heap.begin(), heap.end(), mergesLater);
+        heap.pop_back();
+        if (routes[best.route].empty() || version[best.route] != best.routeVersion)
+        {
+            continue;
+        }
+        if (routes[best.partner].empty() || version[best.partner] != best.partnerVersion)
+        {
+            if (addBest(best.route))
+            {
+                std::push_heap(heap.begin(), heap.end(), mergesLater);
+            }
+            continue;
+        }
+
+        // The merged route takes the lower slot, the other one goes back to the pool
+        const size_t first = best.routeFirst ? best.route : best.partner;
+        const size_t second = best.routeFirst ? best.partner : best.route;
+        const size_t kept = std::min(first, second);
+        std::vector<int> &firstRoute = routes[first];
+        std::vector<int> &secondRoute = routes[second];
+        if (kept == first)
+        {
+            firstRoute.pop_back();
+            firstRoute.insert(firstRoute.end(), secondRoute.begin() + 1, secondRoute.end());
+        }
+        else
+        {
+            secondRoute.erase(secondRoute.begin());
+            secondRoute.insert(secondRoute.begin(), firstRoute.begin(), firstRoute.end() - 1);
+        }
+        releaseRoute(routes[std::max(first, second)]);
+        // Measured again rather than kept from the saving, so the total adds up the same as distanceOfRoutes
+        lengths[kept] = routeDistanceWith(routes[kept], d);
+        setEnds(kept);
+        ++version[kept];
+        lastMerge[kept] = ++merges;
+        if (addBest(kept))
+        {
+            std::push_heap(heap.begin(), heap.end(), mergesLater);
+        }
     }
-    else
+    if (merges == 0)
     {
-        parentB = parents[0];
-        parentA = parents[1];
+        return;
     }
 
-    child = routeCrossover(parentA, parentB, maxPackages, distMatrix);
-    mutation(child, mutationProb, maxPackages);
-    twoOptSwap(child, distMatrix);
-    updateDistance(child, distMatrix);
-    return child;
+    order.clear();
+    for (size_t r = 0; r < numRoutes; ++r)
+    {
+        if (!routes[r].empty())
+        {
+            order.push_back(r);
+        }
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+              { return lastMerge[a] != lastMerge[b] ? lastMerge[a] < lastMerge[b] : a < b; });
+    reordered.clear();
+    reorderedLengths.clear();
+    for (size_t r : order)
+    {
+        reordered.push_back(std::move(routes[r]));
+        reorderedLengths.push_back(lengths[r]);
+    }
+    routes.resize(order.size());
+    lengths.resize(order.size());
+    for (size_t k = 0; k < order.size(); ++k)
+    {
+        routes[k] = std::move(reordered[k]);
+        lengths[k] = reorderedLengths[k];
+    }
 }
 
-Individual routeCrossover(const Individual &parentA, const Individual &parentB, const size_t maxPackages, const Matrix &distMatrix)
+/* Route crossover
+    - Copies the first half of parentA's routes into child, then every route of parentB without the locations that
+      are already used.
+    - Then merges the routes in order of the distance it saves, see mergeRoutes.
+    - The old routes of child go back to the route pool and the new ones are taken from it.
+    - Fills the lengths of child: the routes of parentA keep their lengths, the other routes are measured once they
+      are complete.
+*/
+void routeCrossover(const Individual &parentA, const Individual &parentB, const size_t maxPackages, const Matrix &distMatrix, Individual &child)
 {
-    std::unordered_set<int> used;
-    std::vector<std::vector<int>> childRoutes;
+    // The customers placed in child so far, emptied in O(1) for every child
+    thread_local EpochMarks placed;
+    placed.clear(distMatrix.size());
+    std::vector<double> &lengths = child.lengths;
+    lengths.clear();
+    const bool parentLengthsKnown = parentA.lengths.size() == parentA.routes.size();
+
+    std::vector<std::vector<int>> &childRoutes = child.routes;
+    releaseRoutes(childRoutes, 0);
 
     // Copy half of the routes from parentA
     for (size_t i = 0; i < parentA.routes.size() / 2; ++i)
     {
-        childRoutes.push_back(parentA.routes[i]);
-        for (int node : parentA.routes[i])
+        std::vector<int> route = takeRoute(maxPackages + 2);
+        route.assign(parentA.routes[i].begin(), parentA.routes[i].end());
+        for (int node : route)
         {
-            used.insert(node);
+            placed.mark(node);
         }
+        lengths.push_back(parentLengthsKnown ? parentA.lengths[i] : routeDistance(route, distMatrix));
+        childRoutes.push_back(std::move(route));
     }
 
     // Fill remaining from parentB
     for (const auto &route : parentB.routes)
     {
-        std::vector<int> newRoute;
+        std::vector<int> newRoute = takeRoute(maxPackages + 2);
+        newRoute.push_back(0);
         for (int node : route)
         {
-            if (node != 0 && used.count(node) == 0)
+            if (node != 0 && !placed.marked(node))
             {
                 newRoute.push_back(node);
-                used.insert(node);
+                placed.mark(node);
             }
         }
-        if (!newRoute.empty())
+        if (newRoute.size() > 1)
         {
             newRoute.push_back(0);
-            newRoute.insert(newRoute.begin(), 0);
-            childRoutes.push_back(newRoute);
+            lengths.push_back(routeDistance(newRoute, distMatrix));
+            childRoutes.push_back(std::move(newRoute));
         }
-    }
-
-    // Check if combining any routes saves on distance
-    for (size_t i = 0; i < childRoutes.size() - 1; ++i)
-    {
-        for (size_t j = i + 1; j < childRoutes.size(); ++j)
+        else
         {
-            if (childRoutes[i].size() + childRoutes[j].size() <= maxPackages + 2)
-            {
-                double distA = routeDistancePerLocation(childRoutes[i], distMatrix) * childRoutes[i].size();
-                double distB = routeDistancePerLocation(childRoutes[j], distMatrix) * childRoutes[j].size();
-                double sumOfSeperateDistances = distA + distB;
-
-                std::vector<int> combinedRoute = {0};
-                combinedRoute.insert(combinedRoute.end(), childRoutes[i].begin() + 1, childRoutes[i].end() - 1);
-                combinedRoute.insert(combinedRoute.end(), childRoutes[j].begin() + 1, childRoutes[j].end() - 1);
-                combinedRoute.push_back(0);
-                double combinedDistance = routeDistancePerLocation(combinedRoute, distMatrix);
-
-                if (combinedDistance < sumOfSeperateDistances)
-                {
-                    childRoutes.erase(childRoutes.begin() + j);
-                    childRoutes.erase(childRoutes.begin() + i);
-                    childRoutes.push_back(combinedRoute);
-
-                    i = -1;
-                    break;
-                }
-            }
+            releaseRoute(newRoute);
         }
     }
 
-    return Individual(childRoutes);
+    withDistances(distMatrix, [&](const auto &d)
+                  { mergeRoutes(childRoutes, lengths, maxPackages, d); });
 }
 
-void mutation(Individual &child, const float mutationProb, const size_t maxPackages)
+void mutation(Individual &child, const float mutationProb, const size_t maxPackages, const Matrix &distMatrix, Rng &rng)
 {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_real_distribution<float> dis(0.0f, 1.0f);
-    float randomNum = dis(gen);
+    float randomNum = rng.uniformFloat();
 
-    if (randomNum <= mutationProb)
+    if (randomNum < mutationProb)
     {
-        moveRandomElement(child, maxPackages);
+        moveRandomElement(child, maxPackages, distMatrix, rng);
     }
 }
 
-void moveRandomElement(Individual &child, const size_t maxPackages)
+void moveRandomElement(Individual &child, const size_t maxPackages, const Matrix &distMatrix, Rng &rng)
 {
-    // In case the new routes don't fit the constraints
-    std::vector<std::vector<int>> originalRoutes = child.routes;
-
     // Randomly selects one location and moves it to a random new place in the routes.
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-
-    std::uniform_int_distribution<int> routeDist(0, child.routes.size() - 1);
-    int sourceRouteIdx = routeDist(gen);
+    // The destination is drawn for the routes as they are once the location is taken out, but nothing changes until the
+    // destination is known to have room, so a move that does not fit needs no copy of the routes to undo it.
+    // The lengths of the source and destination routes are measured again when the lengths are known.
+    std::vector<std::vector<int>> &routes = child.routes;
+    std::vector<double> &lengths = child.lengths;
+    const bool lengthsKnown = lengths.size() == routes.size();
+    int sourceRouteIdx = rng.uniformInt(0, routes.size() - 1);
+    int sourceElementIdx = rng.uniformInt(1, routes[sourceRouteIdx].size() - 2);
 
-    std::uniform_int_distribution<int> elemDist(1, child.routes[sourceRouteIdx].size() - 2);
-    int sourceElementIdx = elemDist(gen);
-
-    int element = child.routes[sourceRouteIdx][sourceElementIdx];
-    child.routes[sourceRouteIdx].erase(child.routes[sourceRouteIdx].begin() + sourceElementIdx);
-    if (child.routes[sourceRouteIdx].size() == 2)
+    // A route left with only the depot is removed, the routes after it move down by one
+    const bool removesSourceRoute = routes[sourceRouteIdx].size() == 3;
+    const int numRoutesAfter = routes.size() - (removesSourceRoute ? 1 : 0);
+    auto sizeAfter = [&](int routeIdx) -> size_t
     {
-        child.routes.erase(child.routes.begin() + sourceRouteIdx);
-    }
+        if (removesSourceRoute && routeIdx >= sourceRouteIdx)
+        {
+            return routes[routeIdx + 1].size();
+        }
+        return routes[routeIdx].size() - (routeIdx == sourceRouteIdx ? 1 : 0);
+    };
 
     int destRouteIdx = sourceRouteIdx;
     int destElementIdx = sourceElementIdx;
+    bool toNewRoute = false;
 
     while (destRouteIdx == sourceRouteIdx && destElementIdx == sourceElementIdx)
     {
-        std::uniform_int_distribution<int> routeDist(0, child.routes.size());
-        destRouteIdx = routeDist(gen);
-        if (destRouteIdx == child.routes.size())
+        destRouteIdx = rng.uniformInt(0, numRoutesAfter);
+        if (destRouteIdx == numRoutesAfter)
+        {
+            toNewRoute = true;
+            break;
+        }
+        destElementIdx = rng.uniformInt(1, sizeAfter(destRouteIdx) - 2);
+    }
+
+    if (!toNewRoute && sizeAfter(destRouteIdx) == maxPackages + 2)
+    {
+        return;
+    }
+
+    int element = routes[sourceRouteIdx][sourceElementIdx];
+    routes[sourceRouteIdx].erase(routes[sourceRouteIdx].begin() + sourceElementIdx);
+    if (removesSourceRoute)
+    {
+        std::rotate(routes.begin() + sourceRouteIdx, routes.begin() + sourceRouteIdx + 1, routes.end());
+        releaseRoutes(routes, routes.size() - 1);
+        if (lengthsKnown)
         {
-            child.routes.push_back({0, element, 0});
-            return;
+            std::rotate(lengths.begin() + sourceRouteIdx, lengths.begin() + sourceRouteIdx + 1, lengths.end());
+            lengths.pop_back();
         }
-        std::uniform_int_distribution<int> elemDist(1, child.routes[destRouteIdx].size() - 2);
-        destElementIdx = elemDist(gen);
+    }
+    else if (lengthsKnown)
+    {
+        lengths[sourceRouteIdx] = routeDistance(routes[sourceRouteIdx], distMatrix);
     }
 
-    if (child.routes[destRouteIdx].size() == maxPackages + 2)
+    if (toNewRoute)
     {
-        child.routes = originalRoutes;
+        std::vector<int> route = takeRoute(maxPackages + 2);
+        route.assign({0, element, 0});
+        if (lengthsKnown)
+        {
+            lengths.push_back(routeDistance(route, distMatrix));
+        }
+        routes.push_back(std::move(route));
         return;
     }
-    child.routes[destRouteIdx].insert(child.routes[destRouteIdx].begin() + destElementIdx, element);
+    routes[destRouteIdx].insert(routes[destRouteIdx].begin() + destElementIdx, element);
+    if (lengthsKnown)
+    {
+        lengths[destRouteIdx] = routeDistance(routes[destRouteIdx], distMatrix);
+    }
 }
 
 void twoOptSwap(Individual &child, const Matrix &distMatrix)
 {
     // Basically switches neighbouring locations and checks to see if distance is lower.
     // Intended to "uncross" paths.
-    std::vector<std::vector<int>> newRoutes;
-    for (const auto &route : child.routes)
+    // Only the lengths of the routes it shortens are measured again.
+    // The candidates are built in per-thread buffers and the shortest is copied into the route, so no move allocates.
+    const bool lengthsKnown = child.lengths.size() == child.routes.size();
+    thread_local std::vector<int> shortestRoute;
+    thread_local std::vector<int> newRoute;
+    for (size_t r = 0; r < child.routes.size(); ++r)
     {
+        std::vector<int> &route = child.routes[r];
         if (route.size() < 5)
         {
-            newRoutes.push_back(route);
             continue;
         }
-        std::vector<int> shortestRoute = route;
         double shortestRouteLength = routeDistancePerLocation(route, distMatrix);
+        bool shortened = false;
         for (size_t i = 1; i < route.size() - 1; ++i)
         {
             for (size_t j = i + 2; j < route.size() - 1; ++j)
             {
-                std::vector<int> newRoute = route;
+                newRoute.assign(route.begin(), route.end());
                 std::reverse(newRoute.begin() + i + 1, newRoute.begin() + j + 1);
                 double newRouteLength = routeDistancePerLocation(newRoute, distMatrix);
                 if (newRouteLength < shortestRouteLength)
                 {
-                    shortestRoute = newRoute;
+                    std::swap(shortestRoute, newRoute);
                     shortestRouteLength = newRouteLength;
+                    shortened = true;
                     i = 0;
                 }
             }
         }
-        newRoutes.push_back(shortestRoute);
+        if (shortened)
+        {
+            route.assign(shortestRoute.begin(), shortestRoute.end());
+            if (lengthsKnown)
+            {
+                child.lengths[r] = routeDistance(route, distMatrix);
+            }
+        }
     }
-    child.routes = newRoutes;
-}
\ No newline at end of file
+}
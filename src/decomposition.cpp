@@ -0,0 +1,277 @@
+#include "decomposition.h"
+#include "utils.h"
+#include "clarke_wright.h"
+#include "genetic_algorithm.h"
+#include "genetic_algo_utils.h"
+#include "routes_progress.h"
+#include "rng.h"
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <iterator>
+
+static const double pi = 3.14159265358979323846;
+
+// Angle of point around the depot, in (-pi, pi].
+static double angleAround(const Point &depot, const Point &point)
+{
+    return std::atan2(point.y - depot.y, point.x - depot.x);
+}
+
+/* Sweep partition of the customers into sectors around the depot, locations[0]
+    - Sorts the customers by their angle around the depot and cuts them into ceil(numCustomers / partitionSize)
+      sectors of nearly the same size.
+    - The sweep starts after the widest empty angle between two customers, so no sector is split there.
+    - Returns the customers of every sector in sweep order.
+*/
+std::vector<std::vector<int>> sweepSectors(const std::vector<Point> &locations, const size_t partitionSize)
+{
+    if (partitionSize == 0)
+    {
+        throw std::invalid_argument("partitionSize must be at least 1");
+    }
+    if (locations.size() < 2)
+    {
+        return {};
+    }
+
+    const size_t numCustomers = locations.size() - 1;
+    std::vector<std::pair<double, int>> angles;
+    angles.reserve(numCustomers);
+    for (size_t i = 1; i < locations.size(); ++i)
+    {
+        angles.push_back({angleAround(locations[0], locations[i]), static_cast<int>(i)});
+    }
+    std::sort(angles.begin(), angles.end());
+
+    size_t start = 0;
+    double widestGap = angles.front().first + 2 * pi - angles.back().first;
+    for (size_t k = 1; k < angles.size(); ++k)
+    {
+        const double gap = angles[k].first - angles[k - 1].first;
+        if (gap > widestGap)
+        {
+            widestGap = gap;
+            start = k;
+        }
+    }
+    std::rotate(angles.begin(), angles.begin() + start, angles.end());
+
+    const size_t numSectors = (numCustomers + partitionSize - 1) / partitionSize;
+    std::vector<std::vector<int>> sectors(numSectors);
+    for (size_t s = 0; s < numSectors; ++s)
+    {
+        const size_t first = s * numCustomers / numSectors;
+        const size_t last = (s + 1) * numCustomers / numSectors;
+        for (size_t k = first; k < last; ++k)
+        {
+            sectors[s].push_back(angles[k].second);
+        }
+    }
+    return sectors;
+}
+
+// Dense matrix of the locations ids, depot first, read from distMatrix. It keeps their locations so the sub-solvers
+// can build neighbour lists with a k-d tree.
+static Matrix getSubMatrix(const Matrix &distMatrix, const std::vector<Point> &locations, const std::vector<int> &ids)
+{
+    const size_t n = ids.size();
+    Matrix sub;
+    sub.data.resize(n * n);
+    sub.rows = std::vector<double *>(n);
+    sub.locations.reserve(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        sub.rows[i] = sub.data.data() + i * n;
+        sub.locations.push_back(locations[ids[i]]);
+    }
+    withDistances(distMatrix, [&](const auto &d)
+                  {
+                      for (size_t i = 0; i < n; ++i)
+                      {
+                          for (size_t j = 0; j < n; ++j)
+                          {
+                              sub.rows[i][j] = d(ids[i], ids[j]);
+                          }
+                      } });
+    return sub;
+}
+
+// Solves the customers ids, ids[0] is the depot, on their own and returns the routes in the numbers of distMatrix.
+// stage and index pick the seed of a genetic sub-solve, so it does not depend on which thread runs it.
+static std::vector<std::vector<int>> solveSubProblem(const Matrix &distMatrix, const std::vector<Point> &locations, const std::vector<int> &ids,
+                                                     const size_t maxPackages, const DecompositionOptions &options, const size_t stage, const size_t index)
+{
+    Matrix sub = getSubMatrix(distMatrix, locations, ids);
+    std::vector<std::vector<int>> routes;
+    if (options.subSolver == SubSolver::Genetic)
+    {
+        GeneticOptions genetic = options.genetic;
+        genetic.recordHistory = false;
+        genetic.monitor = nullptr;
+        genetic.seed = Rng(options.genetic.seed, stage, index)();
+        routes = geneticSolver(sub, maxPackages, options.populationSize, options.generations, options.mutationProb, options.startingType, genetic)
+                     .progress.back();
+    }
+    else
+    {
+        routes = clarkeWrightSolver(sub, maxPackages, options.numNeighbours, false).first;
+    }
+
+    for (auto &route : routes)
+    {
+        for (int &customer : route)
+        {
+            customer = ids[customer];
+        }
+    }
+    return routes;
+}
+
+// Indices of the routes ordered by the angle of their centre around the depot, counted from startAngle, so routes
+// next to each other in the order are neighbours on the map.
+static std::vector<size_t> routesByAngle(const std::vector<std::vector<int>> &routes, const std::vector<Point> &locations, const double startAngle)
+{
+    std::vector<std::pair<double, size_t>> keys;
+    keys.reserve(routes.size());
+    for (size_t r = 0; r < routes.size(); ++r)
+    {
+        Point centre = {0.0, 0.0};
+        for (size_t k = 1; k + 1 < routes[r].size(); ++k)
+        {
+            centre.x += locations[routes[r][k]].x;
+            centre.y += locations[routes[r][k]].y;
+        }
+        const double count = std::max<double>(1.0, static_cast<double>(routes[r].size()) - 2);
+        centre = {centre.x / count, centre.y / count};
+        keys.push_back({std::fmod(angleAround(locations[0], centre) - startAngle + 4 * pi, 2 * pi), r});
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<size_t> order;
+    order.reserve(routes.size());
+    for (const auto &[angle, r] : keys)
+    {
+        order.push_back(r);
+    }
+    return order;
+}
+
+/* Decomposition solver for instances too large to solve at once
+    - Returns the final routes and their progress, like clarkeWrightSolver. locations are the locations of
+      distMatrix, depot first, and are used to find the sectors and windows.
+    - Steps:
+    1. Split the customers into sectors of about options.partitionSize customers with sweepSectors.
+    2. Solve every sector on its own with the sub-solver, the sectors in parallel. The sub-solvers' own parallel loops
+       then run on the thread of their sector.
+    3. Improve across the sector boundaries: order the routes by angle and re-solve windows of options.windowRoutes
+       neighbouring routes. A window's new routes replace its old ones only when they are shorter in total.
+       Windows of one round do not overlap and are solved in parallel, every second round is shifted by half a window
+       so the next round re-solves the boundaries of the last one. Each of the options.windowPasses passes is two rounds.
+    - With recordHistory the progress holds the routes after the sectors and after every round that changed them.
+*/
+std::pair<std::vector<std::vector<int>>, RoutesProgress>
+decompositionSolver(const Matrix &distMatrix, const std::vector<Point> &locations, const size_t maxPackages, const DecompositionOptions &options)
+{
+    if (locations.size() != distMatrix.size())
+    {
+        throw std::invalid_argument("decompositionSolver needs the location of every row of the matrix, got " + std::to_string(locations.size()) +
+                                    " locations for " + std::to_string(distMatrix.size()) + " rows");
+    }
+    if (options.subSolver >= SubSolver::COUNT)
+    {
+        throw std::invalid_argument("subSolver must be ClarkeWright or Genetic");
+    }
+
+    RoutesProgress routesProgress(options.recordHistory);
+    std::vector<std::vector<int>> routes;
+    const std::vector<std::vector<int>> sectors = sweepSectors(locations, options.partitionSize);
+    if (sectors.empty())
+    {
+        routesProgress.keyframe(routes);
+        return {std::move(routes), std::move(routesProgress)};
+    }
+    const double startAngle = angleAround(locations[0], locations[sectors[0][0]]);
+
+    // 1. & 2.
+    std::vector<std::vector<std::vector<int>>> sectorRoutes(sectors.size());
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t s = 0; s < sectors.size(); ++s)
+    {
+        std::vector<int> ids = {0};
+        ids.insert(ids.end(), sectors[s].begin(), sectors[s].end());
+        sectorRoutes[s] = solveSubProblem(distMatrix, locations, ids, maxPackages, options, 0, s);
+    }
+    for (auto &sector : sectorRoutes)
+    {
+        std::move(sector.begin(), sector.end(), std::back_inserter(routes));
+    }
+    routesProgress.keyframe(routes);
+
+    // 3.
+    const size_t windowRoutes = options.windowRoutes;
+    const size_t numRounds = windowRoutes > 0 ? 2 * options.windowPasses : 0;
+    for (size_t round = 0; round < numRounds; ++round)
+    {
+        const std::vector<size_t> order = routesByAngle(routes, locations, startAngle);
+        const size_t offset = round % 2 == 0 ? 0 : windowRoutes / 2;
+        std::vector<size_t> windowStarts;
+        for (size_t first = offset; first < order.size(); first += windowRoutes)
+        {
+            windowStarts.push_back(first);
+        }
+
+        std::vector<std::vector<std::vector<int>>> improved(windowStarts.size());
+        std::vector<char> isImproved(windowStarts.size(), 0);
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t w = 0; w < windowStarts.size(); ++w)
+        {
+            const size_t first = windowStarts[w];
+            const size_t last = std::min(order.size(), first + windowRoutes);
+            std::vector<int> ids = {0};
+            double oldDistance = 0.0;
+            for (size_t k = first; k < last; ++k)
+            {
+                const std::vector<int> &route = routes[order[k]];
+                ids.insert(ids.end(), route.begin() + 1, route.end() - 1);
+                oldDistance += routeDistance(route, distMatrix);
+            }
+            improved[w] = solveSubProblem(distMatrix, locations, ids, maxPackages, options, round + 1, w);
+            // Reversed routes or another summation order can look shorter by rounding alone
+            isImproved[w] = distanceOfRoutes(improved[w], distMatrix) < oldDistance * (1.0 - 1e-9);
+        }
+
+        if (std::find(isImproved.begin(), isImproved.end(), 1) == isImproved.end())
+        {
+            continue;
+        }
+        std::vector<std::vector<int>> next;
+        next.reserve(routes.size());
+        for (size_t k = 0; k < offset && k < order.size(); ++k)
+        {
+            next.push_back(std::move(routes[order[k]]));
+        }
+        for (size_t w = 0; w < windowStarts.size(); ++w)
+        {
+            const size_t first = windowStarts[w];
+            const size_t last = std::min(order.size(), first + windowRoutes);
+            if (isImproved[w])
+            {
+                std::move(improved[w].begin(), improved[w].end(), std::back_inserter(next));
+                continue;
+            }
+            for (size_t k = first; k < last; ++k)
+            {
+                next.push_back(std::move(routes[order[k]]));
+            }
+        }
+        routes = std::move(next);
+        routesProgress.keyframe(routes);
+    }
+
+    return {std::move(routes), std::move(routesProgress)};
+}
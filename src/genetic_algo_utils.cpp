@@ -1,10 +1,13 @@
 #include "genetic_algo_utils.h"
 #include "utils.h"
 #include "clarke_wright.h"
+#include "spatial_index.h"
 #include <vector>
 #include <numeric>
 #include <algorithm>
-#include <random>
+#include <array>
+#include <memory>
+#include <limits>
 
 std::ostream &operator<<(std::ostream &os, const Individual &individual)
 {
@@ -21,16 +24,55 @@ std::ostream &operator<<(std::ostream &os, const Individual &individual)
     return os;
 }
 
-std::vector<std::vector<int>> getRandomRoutes(const size_t distMatrixSize, const size_t maxPackages)
+static std::vector<std::vector<int>> &routePool()
+{
+    thread_local std::vector<std::vector<int>> pool;
+    return pool;
+}
+
+// An empty route with room for at least capacity locations, reused from the pool when there is one.
+std::vector<int> takeRoute(const size_t capacity)
+{
+    std::vector<std::vector<int>> &pool = routePool();
+    std::vector<int> route;
+    if (!pool.empty())
+    {
+        route = std::move(pool.back());
+        pool.pop_back();
+        route.clear();
+    }
+    route.reserve(capacity);
+    return route;
+}
+
+// Moves route into the pool, it is left empty.
+void releaseRoute(std::vector<int> &route)
+{
+    routePool().push_back(std::move(route));
+    route = std::vector<int>();
+}
+
+// Releases routes[first, end) and removes them from routes.
+void releaseRoutes(std::vector<std::vector<int>> &routes, const size_t first)
+{
+    for (size_t i = first; i < routes.size(); ++i)
+    {
+        releaseRoute(routes[i]);
+    }
+    routes.resize(first);
+}
+
+std::vector<std::vector<int>> getRandomRoutes(const size_t distMatrixSize, const size_t maxPackages, Rng &rng)
 {
     // vector populateed from 1 to size-1
     std::vector<int> locations(distMatrixSize - 1);
     std::iota(locations.begin(), locations.end(), 1);
 
-    // randomly shuffle the vector
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::shuffle(locations.begin(), locations.end(), gen);
+    // randomly shuffle the vector (Fisher-Yates with rng itself, as std::shuffle differs between standard libraries)
+    for (size_t i = locations.size(); i > 1; --i)
+    {
+        std::swap(locations[i - 1], locations[rng.uniformInt(static_cast<std::uint32_t>(i))]);
+    }
 
     // split into routes of size 2 less than maxPackages to allow room for mutatuion
     std::vector<std::vector<int>> routes;
@@ -46,27 +88,24 @@ std::vector<std::vector<int>> getRandomRoutes(const size_t distMatrixSize, const
     return routes;
 }
 
-std::vector<Individual> getRandomPopulation(const Matrix &distMatrix, const size_t populationSize, const size_t maxPackages)
+// Individual i is shuffled with its own stream of seed, so the population is the same for any number of threads.
+std::vector<Individual> getRandomPopulation(const Matrix &distMatrix, const size_t populationSize, const size_t maxPackages, const std::uint64_t seed)
 {
-    std::vector<Individual> population;
-    population.reserve(populationSize);
+    std::vector<Individual> population(populationSize);
+#pragma omp parallel for
     for (size_t i = 0; i < populationSize; ++i)
     {
-        std::vector<std::vector<int>> routes = getRandomRoutes(distMatrix.rows.size(), maxPackages);
-        double totalDistance = distanceOfRoutes(routes, distMatrix);
-        population.emplace_back(routes, totalDistance);
+        Rng rng(seed, 0, i);
+        population[i].routes = getRandomRoutes(distMatrix.size(), maxPackages, rng);
+        updateDistance(population[i], distMatrix);
     }
     return population;
 }
 
 double routeDistance(const std::vector<int> &route, const Matrix &distMatrix)
 {
-    double distance = 0.0;
-    for (size_t i = 0; i < route.size() - 1; ++i)
-    {
-        distance += distMatrix.rows[route[i]][route[i + 1]];
-    }
-    return distance;
+    return withDistances(distMatrix, [&](const auto &d)
+                         { return routeDistanceWith(route, d); });
 }
 
 double routeDistancePerLocation(const std::vector<int> &route, const Matrix &distMatrix)
@@ -77,7 +116,7 @@ double routeDistancePerLocation(const std::vector<int> &route, const Matrix &dis
 
 double distanceOfRoutes(const std::vector<std::vector<int>> &routes, const Matrix &distMatrix)
 {
-    double total_distance;
+    double total_distance = 0.0;
     for (const auto &route : routes)
     {
         total_distance += routeDistance(route, distMatrix);
@@ -85,82 +124,123 @@ double distanceOfRoutes(const std::vector<std::vector<int>> &routes, const Matri
     return total_distance;
 }
 
-std::vector<Individual> selectParents(const std::vector<Individual> &population, const size_t numOfParentCandidates, const size_t numOfParents)
+std::array<size_t, 2> selectParents(const std::vector<double> &fitness, const size_t numOfParentCandidates, Rng &rng)
 {
     // Randomly select numOfParentCandidates individuals and choose the best one as a parent.
-    // Repeat NumOfParents times.
+    // Repeat for both parents. Only the fitness of the candidates is read, the parents are returned as population indices.
 
-    std::vector<Individual> parents;
-    for (size_t i = 0; i < numOfParents; ++i)
+    std::array<size_t, 2> parents;
+    for (auto &parent : parents)
     {
-        std::vector<Individual> parentCandidates;
-        for (size_t j = 0; j < numOfParentCandidates; ++j)
+        parent = rng.uniformInt(fitness.size());
+        for (size_t j = 1; j < numOfParentCandidates; ++j)
         {
-            int idx = rand() % population.size();
-            parentCandidates.push_back(population[idx]);
-        }
-        Individual bestCandidate = *std::min_element(
-            parentCandidates.begin(),
-            parentCandidates.end(),
-            [](const Individual &a, const Individual &b)
+            size_t candidate = rng.uniformInt(fitness.size());
+            if (fitness[candidate] < fitness[parent])
             {
-                return a.total_distance < b.total_distance;
-            });
-        parents.push_back(bestCandidate);
+                parent = candidate;
+            }
+        }
     }
 
     return parents;
 }
 
+// Measures every route of child again and sets its lengths and total distance.
 void updateDistance(Individual &child, const Matrix &distMatrix)
 {
-    child.total_distance = distanceOfRoutes(child.routes, distMatrix);
+    child.lengths.resize(child.routes.size());
+    for (size_t i = 0; i < child.routes.size(); ++i)
+    {
+        child.lengths[i] = routeDistance(child.routes[i], distMatrix);
+    }
+    updateTotalDistance(child);
 }
 
-Individual bestFromPopulation(const std::vector<Individual> &population)
+// Sets the total distance of child from its route lengths, in the order distanceOfRoutes adds them up.
+void updateTotalDistance(Individual &child)
 {
-    Individual bestIndiv = population[0];
+    child.total_distance = 0.0;
+    for (double length : child.lengths)
+    {
+        child.total_distance += length;
+    }
+}
+
+// Index of the individual with the shortest total distance, the first one if several are equally short.
+size_t bestInPopulation(const std::vector<Individual> &population)
+{
+    size_t bestIndex = 0;
     for (size_t i = 1; i < population.size(); i++)
     {
-        if (population[i].total_distance < bestIndiv.total_distance)
+        if (population[i].total_distance < population[bestIndex].total_distance)
         {
-            bestIndiv = population[i];
+            bestIndex = i;
         }
     }
 
-    return bestIndiv;
+    return bestIndex;
 }
 
+/* Nearest neighbour routes
+    - A route starts at the customer closest to the depot and goes on to the closest customer not visited yet, until
+      it holds maxPackages / 2 customers.
+    - With the locations of the matrix known the customers left are kept in a RemovableKdTree, so every step takes
+      O(log n) instead of a scan over all customers left. Both pick the lowest numbered of equally close customers.
+*/
 Individual createNearestNeighbourIndividual(const Matrix &distMatrix, const size_t maxPackages)
 {
-    std::vector<int> unUsedLocations(distMatrix.rows.size() - 1);
-    std::iota(unUsedLocations.begin(), unUsedLocations.end(), 1);
+    const int numCustomers = static_cast<int>(distMatrix.size()) - 1;
     std::vector<std::vector<int>> routes = {};
 
-    while (!unUsedLocations.empty())
+    // The tree prunes by the distances between locations, so it only finds the customer of the scan when the matrix
+    // holds exactly those distances. Float32 and FixedPoint round them, and a pruned branch may hold the customer.
+    const bool exactDistances = distMatrix.storage == MatrixStorage::Dense || distMatrix.storage == MatrixStorage::PackedTriangular ||
+                                distMatrix.storage == MatrixStorage::Coordinates;
+    std::unique_ptr<RemovableKdTree> tree;
+    std::vector<int> unUsedLocations;
+    if (exactDistances && distMatrix.locations.size() == distMatrix.size())
     {
-        int lastLoc;
-        bool newRoute = routes.size() == 0 || routes.back().size() == maxPackages / 2;
-        if (newRoute)
-        {
-            lastLoc = 0;
-        }
-        else
+        std::vector<Point> customers(distMatrix.locations.begin() + 1, distMatrix.locations.end());
+        std::vector<int> ids(numCustomers);
+        std::iota(ids.begin(), ids.end(), 1);
+        tree = std::make_unique<RemovableKdTree>(buildKdTree(customers, ids));
+    }
+    else
+    {
+        unUsedLocations.resize(numCustomers);
+        std::iota(unUsedLocations.begin(), unUsedLocations.end(), 1);
+    }
+
+    // Takes the closest customer left to lastLoc out of the customers left
+    auto takeNearest = [&](const int lastLoc)
+    {
+        if (tree)
         {
-            lastLoc = routes.back().back();
+            const int minLoc = tree->nearest(distMatrix, lastLoc);
+            tree->remove(minLoc);
+            return minLoc;
         }
-
-        int minLoc = 0;
+        size_t minIndex = 0;
         double minDist = std::numeric_limits<double>::infinity();
-        for (const auto loc : unUsedLocations)
+        for (size_t k = 0; k < unUsedLocations.size(); ++k)
         {
-            if (distMatrix.rows[lastLoc][loc] < minDist)
+            if (distMatrix(lastLoc, unUsedLocations[k]) < minDist)
             {
-                minDist = distMatrix.rows[lastLoc][loc];
-                minLoc = loc;
+                minDist = distMatrix(lastLoc, unUsedLocations[k]);
+                minIndex = k;
             }
         }
+        const int minLoc = unUsedLocations[minIndex];
+        unUsedLocations.erase(unUsedLocations.begin() + minIndex);
+        return minLoc;
+    };
 
+    for (int step = 0; step < numCustomers; ++step)
+    {
+        bool newRoute = routes.size() == 0 || routes.back().size() == maxPackages / 2;
+        int lastLoc = newRoute ? 0 : routes.back().back();
+        int minLoc = takeNearest(lastLoc);
         if (newRoute)
         {
             routes.push_back({minLoc});
@@ -169,8 +249,6 @@ Individual createNearestNeighbourIndividual(const Matrix &distMatrix, const size
         {
             routes.back().push_back(minLoc);
         }
-        auto minLocIdx = std::find(unUsedLocations.begin(), unUsedLocations.end(), minLoc);
-        unUsedLocations.erase(minLocIdx);
     }
 
     for (auto &route : routes)
@@ -179,13 +257,15 @@ Individual createNearestNeighbourIndividual(const Matrix &distMatrix, const size
         route.push_back(0);
     }
 
-    double routesDistance = distanceOfRoutes(routes, distMatrix);
-    return Individual(routes, routesDistance);
+    Individual individual(routes);
+    updateDistance(individual, distMatrix);
+    return individual;
 }
 
 Individual createCalrkeWrightIndividual(const Matrix &distMatrix, const size_t maxPackages)
 {
-    auto [routes, routesProgress] = clarkeWrightSolver(distMatrix, maxPackages);
-    double totalDistance = distanceOfRoutes(routes, distMatrix);
-    return Individual(routes, totalDistance);
+    auto [routes, routesProgress] = clarkeWrightSolver(distMatrix, maxPackages, 0, false);
+    Individual individual(routes);
+    updateDistance(individual, distMatrix);
+    return individual;
 }
\ No newline at end of file
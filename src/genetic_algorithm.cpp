@@ -3,49 +3,48 @@
 #include "create_child.h"
 #include "utils.h"
 #include "clarke_wright.h"
+#include "giant_tour.h"
 #include <vector>
+#include <array>
 #include <numeric>
 #include <algorithm>
-#include <random>
 #include <omp.h>
 #include <iostream>
+#include <limits>
+#include <cstdint>
+#include <chrono>
 
-/* Genetic Algorithm Steps:
-1. Start with some initial population of sets of routes, dictated by startingType.
-2. Evaluate the fitness of each set of routes (total distance)
-3. Select the parents or the next generation via tournament style: For each parent randomly choose three possible candidates and select the one with the better fitness.
-4-6 are performed for each two parents right after they are selected, in the createChild function.
-    4. Route Crossover: Copy half of the fittest parent's routes to intialize the child routes. Fill in the rest of the locations based on the second parent.
-       Check if combining any routes saves on distance.
-    5. Mutation: With some probability, randomly move one location to a different route.
-    6. Memetic Algorithm: Perform a 2-opt search in each route.
-7. Repeat Steps 2-6 until the maximum number of generations is hit.
-*/
-std::vector<std::vector<std::vector<int>>> geneticSolver(
+const size_t numOfParentCandidates = 3; // selectParents picks 2 parents, which createChild combines
+
+// One island of the genetic solver: its population, the buffer its children are written to and the population's fitness.
+struct Island
+{
+    std::vector<Individual> population;
+    std::vector<Individual> nextPopulation;
+    std::vector<double> fitness;
+    size_t generations = 0;
+};
+
+// An island of the giant tour representation. Its populationSize tours of numCustomers customers lie one after the
+// other in tours, so every individual is a slice of the same size that is copied in one go.
+struct TourIsland
+{
+    size_t numCustomers = 0;
+    std::vector<int> tours;
+    std::vector<int> nextTours;
+    std::vector<double> fitness;
+    std::vector<double> nextFitness;
+    size_t generations = 0;
+};
+
+// Step 1, the first generation of populationSize individuals.
+static std::vector<Individual> createPopulation(
     const Matrix &distMatrix,
     const size_t maxPackages,
     const size_t populationSize,
-    const size_t maxGenerations,
-    const float mutationProb,
-    const StartingType startingType)
+    const StartingType startingType,
+    const std::uint64_t seed)
 {
-    if (mutationProb < 0.0 || mutationProb > 1.0)
-    {
-        throw std::invalid_argument("mutationProb must be between 0 and 1, got: " + std::to_string(mutationProb));
-    }
-    if (maxPackages < 2)
-    {
-        throw std::invalid_argument("maxPackages must be greater than 2, got: " + std::to_string(maxPackages));
-    }
-    if (distMatrix.rows.size() == 0)
-    {
-        throw std::invalid_argument("distance matrix was empty");
-    }
-
-    size_t numOfParentCandidates = 3;
-    size_t numOfParents = 2; // The createChild function assumes 2 parents
-
-    // Create 1st generation
     std::vector<Individual> population;
     population.reserve(populationSize);
 
@@ -72,7 +71,7 @@ std::vector<std::vector<std::vector<int>>> geneticSolver(
     }
     case StartingType::Random:
     {
-        population = getRandomPopulation(distMatrix, populationSize, maxPackages);
+        population = getRandomPopulation(distMatrix, populationSize, maxPackages, seed);
         break;
     }
     case StartingType::Mixed:
@@ -80,7 +79,7 @@ std::vector<std::vector<std::vector<int>>> geneticSolver(
         Individual clarkeWrightIndividual = createCalrkeWrightIndividual(distMatrix, maxPackages);
         Individual nearestNeighbourIndividual = createNearestNeighbourIndividual(distMatrix, maxPackages);
 
-        population = getRandomPopulation(distMatrix, populationSize / 3, maxPackages);
+        population = getRandomPopulation(distMatrix, populationSize / 3, maxPackages, seed);
 
         size_t remaining = populationSize - population.size();
         for (size_t i = 0; i < remaining; i += 2)
@@ -96,30 +95,419 @@ std::vector<std::vector<std::vector<int>>> geneticSolver(
     default:
         throw std::invalid_argument("Starting type must be ClarkeWright, NearestNeighbours, Random, or Mixed");
     }
+    return population;
+}
+
+// Steps 2-6 for one generation of an island. Children are written over the individuals of the generation before the
+// current one, then the buffers swap. firstFamily numbers the island's families apart from the other islands'.
+static void evolveGeneration(
+    Island &island,
+    const Matrix &distMatrix,
+    const size_t maxPackages,
+    const float mutationProb,
+    const GeneticOptions &options,
+    const size_t generation,
+    const size_t firstFamily,
+    const bool parallel)
+{
+    // Selection only compares fitness, so it reads this array instead of the individuals
+    const size_t populationSize = island.population.size();
+    for (size_t i = 0; i < populationSize; ++i)
+    {
+        island.fitness[i] = island.population[i].total_distance;
+    }
+
+#pragma omp parallel for if (parallel)
+    for (size_t family = 0; family < populationSize; ++family)
+    {
+        // Every child draws from its own stream, so it does not matter which thread creates it
+        Rng rng(options.seed, generation + 1, firstFamily + family);
+        std::array<size_t, 2> parents = selectParents(island.fitness, numOfParentCandidates, rng);
+        createChild(island.population[parents[0]], island.population[parents[1]], island.nextPopulation[family], maxPackages, mutationProb, distMatrix, rng, options.localSearch);
+    }
+    std::swap(island.population, island.nextPopulation);
+}
+
+// Steps 2-6 for one generation of a giant tour island, see createTourChild.
+static void evolveGeneration(
+    TourIsland &island,
+    const Matrix &distMatrix,
+    const size_t maxPackages,
+    const float mutationProb,
+    const GeneticOptions &options,
+    const size_t generation,
+    const size_t firstFamily,
+    const bool parallel)
+{
+    const size_t populationSize = island.fitness.size();
+    const size_t n = island.numCustomers;
+
+#pragma omp parallel for if (parallel)
+    for (size_t family = 0; family < populationSize; ++family)
+    {
+        Rng rng(options.seed, generation + 1, firstFamily + family);
+        std::array<size_t, 2> parents = selectParents(island.fitness, numOfParentCandidates, rng);
+        island.nextFitness[family] = createTourChild(island.tours.data() + parents[0] * n, island.fitness[parents[0]],
+                                                     island.tours.data() + parents[1] * n, island.fitness[parents[1]],
+                                                     island.nextTours.data() + family * n, n, maxPackages, mutationProb, distMatrix, rng, options.localSearch);
+    }
+    std::swap(island.tours, island.nextTours);
+    std::swap(island.fitness, island.nextFitness);
+}
+
+// What the solver and migrate need of an island, for both representations.
+static size_t populationSizeOf(const Island &island)
+{
+    return island.population.size();
+}
+
+static size_t populationSizeOf(const TourIsland &island)
+{
+    return island.fitness.size();
+}
+
+static double distanceOf(const Island &island, const size_t k)
+{
+    return island.population[k].total_distance;
+}
+
+static double distanceOf(const TourIsland &island, const size_t k)
+{
+    return island.fitness[k];
+}
+
+// Index of the shortest individual, the first one if several are equally short.
+static size_t bestOf(const Island &island)
+{
+    return bestInPopulation(island.population);
+}
+
+static size_t bestOf(const TourIsland &island)
+{
+    return std::min_element(island.fitness.begin(), island.fitness.end()) - island.fitness.begin();
+}
+
+static void keyframeOf(RoutesProgress &progress, const Island &island, const size_t k, const size_t, const Matrix &)
+{
+    progress.keyframe(island.population[k].routes);
+}
+
+static void keyframeOf(RoutesProgress &progress, const TourIsland &island, const size_t k, const size_t maxPackages, const Matrix &distMatrix)
+{
+    // Kept for the next improvement, the split gives its old routes back to the route pool
+    thread_local std::vector<std::vector<int>> routes;
+    splitTour(island.tours.data() + k * island.numCustomers, island.numCustomers, maxPackages, distMatrix, routes);
+    progress.keyframe(routes);
+}
+
+static Individual copyOf(const Island &island, const size_t k)
+{
+    return island.population[k];
+}
+
+static std::pair<std::vector<int>, double> copyOf(const TourIsland &island, const size_t k)
+{
+    const int *tour = island.tours.data() + k * island.numCustomers;
+    return {std::vector<int>(tour, tour + island.numCustomers), island.fitness[k]};
+}
+
+static void replace(Island &island, const size_t k, const Individual &individual)
+{
+    island.population[k] = individual;
+}
+
+static void replace(TourIsland &island, const size_t k, const std::pair<std::vector<int>, double> &tour)
+{
+    std::copy(tour.first.begin(), tour.first.end(), island.tours.begin() + k * island.numCustomers);
+    island.fitness[k] = tour.second;
+}
+
+/* Migration between islands after the given generation
+    - Every island sends copies of its best individuals to one other island, the next one for Ring and a random other
+      one for Random. They replace the worst individuals there.
+    - All migrants are copied before any island changes, so the order the islands are handled in does not matter.
+*/
+template <typename IslandType>
+static void migrate(std::vector<IslandType> &islands, const IslandOptions &islandOptions, const std::uint64_t seed, const size_t generation)
+{
+    const size_t numIslands = islands.size();
+    const size_t numMigrants = islandOptions.migrants;
+    std::vector<std::vector<decltype(copyOf(islands[0], 0))>> migrants(numIslands);
+    std::vector<size_t> order;
+
+    auto sortedByDistance = [&](const IslandType &island, const bool worstFirst)
+    {
+        order.resize(populationSizeOf(island));
+        std::iota(order.begin(), order.end(), 0);
+        std::partial_sort(order.begin(), order.begin() + numMigrants, order.end(), [&](size_t a, size_t b)
+                          {
+                              if (distanceOf(island, a) != distanceOf(island, b))
+                              {
+                                  return worstFirst ? distanceOf(island, a) > distanceOf(island, b)
+                                                    : distanceOf(island, a) < distanceOf(island, b);
+                              }
+                              return a < b; });
+    };
+
+    for (size_t i = 0; i < numIslands; ++i)
+    {
+        sortedByDistance(islands[i], false);
+        for (size_t k = 0; k < numMigrants; ++k)
+        {
+            migrants[i].push_back(copyOf(islands[i], order[k]));
+        }
+    }
+
+    // The destinations of Random get their own stream, apart from the ones of the children
+    Rng rng(seed, generation + 1, UINT64_MAX);
+    for (size_t i = 0; i < numIslands; ++i)
+    {
+        size_t destination = (i + 1) % numIslands;
+        if (islandOptions.topology == MigrationTopology::Random)
+        {
+            destination = (i + 1 + rng.uniformInt(numIslands - 1)) % numIslands;
+        }
+
+        sortedByDistance(islands[destination], true);
+        for (size_t k = 0; k < numMigrants; ++k)
+        {
+            replace(islands[destination], order[k], migrants[i][k]);
+        }
+    }
+}
 
-    Individual bestIndividual = bestFromPopulation(population);
-    std::vector<std::vector<std::vector<int>>> bestRoutesProgress = {bestIndividual.routes};
+// Steps 2-7 for the islands of either representation, from the first generation on.
+template <typename IslandType>
+static GeneticResult evolveIslands(
+    std::vector<IslandType> &islands,
+    const Matrix &distMatrix,
+    const size_t maxPackages,
+    const size_t populationSize,
+    const size_t maxGenerations,
+    const float mutationProb,
+    const GeneticOptions &options,
+    const std::chrono::steady_clock::time_point start)
+{
+    const size_t numIslands = islands.size();
+
+    // The best routes so far are kept in the progress, only their distance is needed here
+    double bestDistance = std::numeric_limits<double>::infinity();
+    RoutesProgress bestRoutesProgress(options.recordHistory);
+    auto recordBest = [&]()
+    {
+        bool improved = false;
+        for (const auto &island : islands)
+        {
+            size_t bestIndex = bestOf(island);
+            if (distanceOf(island, bestIndex) < bestDistance)
+            {
+                bestDistance = distanceOf(island, bestIndex);
+                keyframeOf(bestRoutesProgress, island, bestIndex, maxPackages, distMatrix);
+                improved = true;
+            }
+        }
+        if (options.monitor != nullptr)
+        {
+            options.monitor->bestDistance.store(bestDistance, std::memory_order_relaxed);
+        }
+        return improved;
+    };
+    recordBest();
+
+    // Only reads the clock, so the island threads can check it without any synchronisation
+    auto timeIsUp = [&]()
+    {
+        return options.timeLimit > 0.0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= options.timeLimit;
+    };
+    auto isCancelled = [&]()
+    {
+        return options.monitor != nullptr && options.monitor->cancelled.load(std::memory_order_relaxed);
+    };
+    auto reportGenerations = [&](const size_t generations)
+    {
+        if (options.monitor != nullptr)
+        {
+            options.monitor->generation.store(generations, std::memory_order_relaxed);
+        }
+    };
+    size_t generationsWithoutImprovement = 0;
+    auto stopReason = [&]()
+    {
+        if (isCancelled())
+        {
+            return StopReason::Cancelled;
+        }
+        if (options.targetDistance > 0.0 && bestDistance <= options.targetDistance)
+        {
+            return StopReason::TargetReached;
+        }
+        if (options.stallGenerations > 0 && generationsWithoutImprovement >= options.stallGenerations)
+        {
+            return StopReason::Stalled;
+        }
+        if (timeIsUp())
+        {
+            return StopReason::TimeLimit;
+        }
+        return StopReason::MaxGenerations;
+    };
 
     // Create the next generations
-    for (size_t generation = 0; generation < maxGenerations; ++generation)
+    if (numIslands == 1)
     {
-        std::vector<Individual> newPopulation(populationSize);
-#pragma omp parallel for
-        for (size_t family = 0; family < populationSize; ++family)
+        size_t generation = 0;
+        StopReason reason = stopReason();
+        while (generation < maxGenerations && reason == StopReason::MaxGenerations)
         {
-            std::vector<Individual> parents = selectParents(population, numOfParentCandidates, numOfParents);
-            Individual child = createChild(parents, maxPackages, mutationProb, distMatrix);
-            newPopulation[family] = child;
+            evolveGeneration(islands[0], distMatrix, maxPackages, mutationProb, options, generation, 0, true);
+            ++generation;
+            generationsWithoutImprovement = recordBest() ? 0 : generationsWithoutImprovement + 1;
+            reportGenerations(generation);
+            reason = stopReason();
         }
-        population = newPopulation;
+        return {std::move(bestRoutesProgress), reason, generation};
+    }
 
-        Individual bestFromCurrentGen = bestFromPopulation(population);
-        if (bestFromCurrentGen.total_distance < bestIndividual.total_distance)
+    const size_t interval = options.islands.migrationInterval;
+    size_t generations = 0;
+    StopReason reason = stopReason();
+    while (generations < maxGenerations && reason == StopReason::MaxGenerations)
+    {
+        const size_t epochStart = generations;
+        const size_t epochEnd = std::min(maxGenerations, epochStart + interval);
+
+        // Islands evolve on their own until the next migration, one thread per island and no barrier per generation.
+        // Each island checks the time limit and cancellation itself between its generations.
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t i = 0; i < numIslands; ++i)
+        {
+            for (size_t generation = epochStart; generation < epochEnd && !timeIsUp() && !isCancelled(); ++generation)
+            {
+                evolveGeneration(islands[i], distMatrix, maxPackages, mutationProb, options, generation, i * populationSize, false);
+                islands[i].generations = generation + 1;
+            }
+        }
+
+        for (const auto &island : islands)
         {
-            bestIndividual = bestFromCurrentGen;
-            bestRoutesProgress.push_back(bestIndividual.routes);
+            generations = std::max(generations, island.generations);
+        }
+        generationsWithoutImprovement = recordBest() ? 0 : generationsWithoutImprovement + (generations - epochStart);
+        reportGenerations(generations);
+        reason = stopReason();
+        if (generations < maxGenerations && reason == StopReason::MaxGenerations)
+        {
+            migrate(islands, options.islands, options.seed, generations);
         }
     }
 
-    return bestRoutesProgress;
+    return {std::move(bestRoutesProgress), reason, generations};
+}
+
+
+/* Genetic Algorithm Steps:
+1. Start with some initial population of sets of routes, dictated by startingType.
+2. Evaluate the fitness of each set of routes (total distance)
+3. Select the parents or the next generation via tournament style: For each parent randomly choose three possible candidates and select the one with the better fitness.
+4-6 are performed for each two parents right after they are selected, in the createChild function.
+    4. Route Crossover: Copy half of the fittest parent's routes to intialize the child routes. Fill in the rest of the locations based on the second parent.
+       Join the routes that save the most distance first, see mergeRoutes.
+    5. Mutation: With some probability, randomly move one location to a different route.
+    6. Memetic Algorithm: Perform a local search in each route (options.localSearch).
+7. Repeat Steps 2-6 until the maximum number of generations is hit.
+- Every child draws its random numbers from its own stream of options.seed, keyed by generation and position in the
+  population, so a seed always gives the same routes whatever the number of threads.
+- Returns the best routes after initialisation and after every improvement, or only the final best routes when
+  options.recordHistory is false.
+- Stops after maxGenerations, or earlier at options.timeLimit, options.stallGenerations, options.targetDistance or
+  when options.monitor is cancelled.
+  The result says which one it was and how many generations ran.
+- With options.representation GiantTour every individual is one permutation of the customers instead, which steps 4-6
+  cross with order crossover and split into the best routes in their order (see createTourChild).
+- With options.islands.count > 1 the population is split into islands that run steps 2-6 on their own (see
+  IslandOptions). Improvements are then recorded once per migration interval.
+*/
+GeneticResult geneticSolver(
+    const Matrix &distMatrix,
+    const size_t maxPackages,
+    const size_t populationSize,
+    const size_t maxGenerations,
+    const float mutationProb,
+    const StartingType startingType,
+    const GeneticOptions &options)
+{
+    if (mutationProb < 0.0 || mutationProb > 1.0)
+    {
+        throw std::invalid_argument("mutationProb must be between 0 and 1, got: " + std::to_string(mutationProb));
+    }
+    if (maxPackages < 2)
+    {
+        throw std::invalid_argument("maxPackages must be greater than 2, got: " + std::to_string(maxPackages));
+    }
+    if (distMatrix.size() == 0)
+    {
+        throw std::invalid_argument("distance matrix was empty");
+    }
+    if (options.localSearch >= LocalSearchType::COUNT)
+    {
+        throw std::invalid_argument("Local search type must be TwoOptSwap, IntraRoute or IntraInterRoute");
+    }
+    if (options.islands.count > 1 && options.islands.migrationInterval == 0)
+    {
+        throw std::invalid_argument("islands.migrationInterval must be at least 1");
+    }
+    if (options.islands.count > 1 && options.islands.migrants >= populationSize)
+    {
+        throw std::invalid_argument("islands.migrants must be less than populationSize, got: " + std::to_string(options.islands.migrants));
+    }
+    if (options.representation >= Representation::COUNT)
+    {
+        throw std::invalid_argument("Representation must be Routes or GiantTour");
+    }
+    if (options.islands.topology >= MigrationTopology::COUNT)
+    {
+        throw std::invalid_argument("Migration topology must be Ring or Random");
+    }
+    if (options.timeLimit < 0.0 || options.targetDistance < 0.0)
+    {
+        throw std::invalid_argument("timeLimit and targetDistance can not be negative");
+    }
+    const auto start = std::chrono::steady_clock::now();
+
+    // Create 1st generation, for all islands at once. The islands take turns picking their individuals from it.
+    const size_t numIslands = std::max<size_t>(options.islands.count, 1);
+    std::vector<Individual> firstGeneration = createPopulation(distMatrix, maxPackages, populationSize * numIslands, startingType, options.seed);
+    if (options.representation == Representation::GiantTour)
+    {
+        const size_t numCustomers = distMatrix.size() - 1;
+        std::vector<TourIsland> islands(numIslands);
+        for (auto &island : islands)
+        {
+            island.numCustomers = numCustomers;
+            island.tours.resize(populationSize * numCustomers);
+            island.nextTours.resize(populationSize * numCustomers);
+            island.fitness.resize(populationSize);
+            island.nextFitness.resize(populationSize);
+        }
+        for (size_t i = 0; i < firstGeneration.size(); ++i)
+        {
+            TourIsland &island = islands[i % numIslands];
+            int *tour = island.tours.data() + (i / numIslands) * numCustomers;
+            giantTour(firstGeneration[i].routes, tour);
+            island.fitness[i / numIslands] = splitTour(tour, numCustomers, maxPackages, distMatrix);
+        }
+        return evolveIslands(islands, distMatrix, maxPackages, populationSize, maxGenerations, mutationProb, options, start);
+    }
+
+    std::vector<Island> islands(numIslands);
+    for (size_t i = 0; i < firstGeneration.size(); ++i)
+    {
+        islands[i % numIslands].population.push_back(std::move(firstGeneration[i]));
+    }
+    for (auto &island : islands)
+    {
+        island.nextPopulation.resize(populationSize);
+        island.fitness.resize(populationSize);
+    }
+    return evolveIslands(islands, distMatrix, maxPackages, populationSize, maxGenerations, mutationProb, options, start);
 }
@@ -0,0 +1,197 @@
+#include "giant_tour.h"
+#include "genetic_algo_utils.h"
+#include "create_child.h"
+#include "local_search.h"
+#include "utils.h"
+#include "epoch_marks.h"
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+// Writes the customers of routes, in route order and without the depots, to tour.
+void giantTour(const std::vector<std::vector<int>> &routes, int *tour)
+{
+    for (const auto &route : routes)
+    {
+        tour = std::copy(route.begin() + 1, route.end() - 1, tour);
+    }
+}
+
+/* Split of a giant tour into routes of at most maxPackages customers
+    - The best routes that keep the order of the tour: potential[j] is the shortest distance to serve the first j
+      customers, and a route from customer i + 1 to customer j costs
+          potential[i] + d(0, tour[i]) + sumDistance[j] - sumDistance[i + 1] + d(tour[j - 1], 0)
+      where sumDistance[k] is the distance along the tour from its first to its k-th customer.
+    - Only the first part depends on i, so the best i for j is the one with the smallest
+      key(i) = potential[i] + d(0, tour[i]) - sumDistance[i + 1] among the maxPackages before j. A queue of the i in the
+      window with rising keys gives it in O(1), so the split is O(n) instead of O(n * maxPackages).
+    - Returns potential[numCustomers], and the routes when predecessor is given.
+*/
+template <typename Distances>
+static double splitWith(const Distances &d, const int *tour, const size_t numCustomers, const size_t maxPackages, std::vector<size_t> *predecessor)
+{
+    thread_local std::vector<double> potential;
+    thread_local std::vector<double> sumDistance;
+    thread_local std::vector<size_t> window;
+    potential.resize(numCustomers + 1);
+    sumDistance.resize(numCustomers + 1);
+    window.resize(numCustomers + 1);
+
+    sumDistance[0] = 0.0;
+    if (numCustomers > 0)
+    {
+        sumDistance[1] = 0.0;
+    }
+    for (size_t k = 2; k <= numCustomers; ++k)
+    {
+        sumDistance[k] = sumDistance[k - 1] + d(tour[k - 2], tour[k - 1]);
+    }
+    auto key = [&](const size_t i)
+    {
+        return potential[i] + d(0, tour[i]) - sumDistance[i + 1];
+    };
+
+    potential[0] = 0.0;
+    size_t front = 0;
+    size_t back = 0;
+    window[back++] = 0;
+    for (size_t j = 1; j <= numCustomers; ++j)
+    {
+        while (window[front] + maxPackages < j)
+        {
+            ++front;
+        }
+        const size_t i = window[front];
+        potential[j] = key(i) + sumDistance[j] + d(tour[j - 1], 0);
+        if (predecessor != nullptr)
+        {
+            (*predecessor)[j] = i;
+        }
+
+        if (j < numCustomers)
+        {
+            const double keyOfJ = key(j);
+            while (back > front && key(window[back - 1]) >= keyOfJ)
+            {
+                --back;
+            }
+            window[back++] = j;
+        }
+    }
+    return potential[numCustomers];
+}
+
+// Total distance of the best split of tour.
+double splitTour(const int *tour, const size_t numCustomers, const size_t maxPackages, const Matrix &distMatrix)
+{
+    return withDistances(distMatrix, [&](const auto &d)
+                         { return splitWith(d, tour, numCustomers, maxPackages, nullptr); });
+}
+
+// Total distance of the best split of tour, whose routes are written to routes. Their old routes go back to the route
+// pool and the new ones are taken from it.
+double splitTour(const int *tour, const size_t numCustomers, const size_t maxPackages, const Matrix &distMatrix, std::vector<std::vector<int>> &routes)
+{
+    thread_local std::vector<size_t> predecessor;
+    predecessor.resize(numCustomers + 1);
+    const double distance = withDistances(distMatrix, [&](const auto &d)
+                                          { return splitWith(d, tour, numCustomers, maxPackages, &predecessor); });
+
+    // The routes are found from the back, so they are filled in reverse and turned around once
+    releaseRoutes(routes, 0);
+    for (size_t j = numCustomers; j > 0; j = predecessor[j])
+    {
+        std::vector<int> route = takeRoute(maxPackages + 2);
+        route.push_back(0);
+        route.insert(route.end(), tour + predecessor[j], tour + j);
+        route.push_back(0);
+        routes.push_back(std::move(route));
+    }
+    std::reverse(routes.begin(), routes.end());
+    return distance;
+}
+
+/* Order crossover (OX)
+    - Copies a random slice of parentA to the same positions of child, then fills the other positions from the one
+      after the slice onwards, wrapping around, with the customers of parentB in their order from the same position.
+    - child keeps the relative order of both parents and never holds a customer twice.
+*/
+void orderCrossover(const int *parentA, const int *parentB, const size_t numCustomers, int *child, Rng &rng)
+{
+    if (numCustomers == 0)
+    {
+        return;
+    }
+    thread_local EpochMarks placed;
+    placed.clear(numCustomers + 1);
+
+    size_t first = rng.uniformInt(static_cast<std::uint32_t>(numCustomers));
+    size_t last = rng.uniformInt(static_cast<std::uint32_t>(numCustomers));
+    if (first > last)
+    {
+        std::swap(first, last);
+    }
+    for (size_t k = first; k <= last; ++k)
+    {
+        child[k] = parentA[k];
+        placed.mark(parentA[k]);
+    }
+
+    size_t position = (last + 1) % numCustomers;
+    for (size_t step = 0; step < numCustomers; ++step)
+    {
+        const int customer = parentB[(last + 1 + step) % numCustomers];
+        if (!placed.marked(customer))
+        {
+            child[position] = customer;
+            position = (position + 1) % numCustomers;
+        }
+    }
+}
+
+/* Creates one giant tour child of first and second in child and returns its total distance
+    - Order crossover, starting from the slice of the fitter parent, then with mutationProb a customer moves to a
+      random other position of the tour.
+    - The child is split into routes for the local search of the route representation, and the improved routes are
+      joined into the tour again. Its distance is that of the best split of the new tour, which is never longer.
+*/
+double createTourChild(const int *first, const double firstDistance, const int *second, const double secondDistance, int *child, const size_t numCustomers,
+                       const size_t maxPackages, const float mutationProb, const Matrix &distMatrix, Rng &rng, const LocalSearchType localSearch)
+{
+    const bool firstIsFitter = firstDistance < secondDistance;
+    orderCrossover(firstIsFitter ? first : second, firstIsFitter ? second : first, numCustomers, child, rng);
+
+    if (numCustomers > 1 && rng.uniformFloat() < mutationProb)
+    {
+        const size_t from = rng.uniformInt(static_cast<std::uint32_t>(numCustomers));
+        const size_t to = rng.uniformInt(static_cast<std::uint32_t>(numCustomers));
+        if (from < to)
+        {
+            std::rotate(child + from, child + from + 1, child + to + 1);
+        }
+        else
+        {
+            std::rotate(child + to, child + from, child + from + 1);
+        }
+    }
+
+    // The routes of the split only live until they are joined again, so one individual per thread holds them
+    thread_local Individual decoded;
+    splitTour(child, numCustomers, maxPackages, distMatrix, decoded.routes);
+    switch (localSearch)
+    {
+    case LocalSearchType::TwoOptSwap:
+        twoOptSwap(decoded, distMatrix);
+        break;
+    case LocalSearchType::IntraRoute:
+        intraRouteSearch(decoded, distMatrix);
+        break;
+    case LocalSearchType::IntraInterRoute:
+        interRouteSearch(decoded, distMatrix, maxPackages);
+        break;
+    default:
+        throw std::invalid_argument("Local search type must be TwoOptSwap, IntraRoute or IntraInterRoute");
+    }
+    giantTour(decoded.routes, child);
+    return splitTour(child, numCustomers, maxPackages, distMatrix);
+}
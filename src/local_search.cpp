@@ -0,0 +1,600 @@
+#include "local_search.h"
+#include "genetic_algo_utils.h"
+#include "utils.h"
+#include <vector>
+#include <algorithm>
+
+// A move has to shorten the route by more than this to be applied, so rounding noise can't make the search cycle.
+const double minGain = 1e-9;
+
+// 2-opt: remove edge (p, p + 1) and edge (q, q + 1), reconnect by reversing everything in between.
+// Both edges next to the location at pos are tried against every other edge of the route.
+template <typename Distances>
+static double tryTwoOpt(std::vector<int> &route, const size_t pos, const Distances &d, std::vector<unsigned char> &dontLook)
+{
+    const size_t lastEdge = route.size() - 2; // Edge e joins route[e] and route[e + 1]
+
+    double bestGain = minGain;
+    size_t bestP = 0;
+    size_t bestQ = 0;
+    for (size_t e = pos - 1; e <= pos; ++e)
+    {
+        for (size_t other = 0; other <= lastEdge; ++other)
+        {
+            // Skip edges that share a location with e
+            if (other + 1 >= e && other <= e + 1)
+            {
+                continue;
+            }
+            size_t p = std::min(e, other);
+            size_t q = std::max(e, other);
+            double gain = d(route[p], route[p + 1]) + d(route[q], route[q + 1]) - d(route[p], route[q]) - d(route[p + 1], route[q + 1]);
+            if (gain > bestGain)
+            {
+                bestGain = gain;
+                bestP = p;
+                bestQ = q;
+            }
+        }
+    }
+
+    if (bestQ == 0)
+    {
+        return 0.0;
+    }
+
+    dontLook[route[bestP]] = 0;
+    dontLook[route[bestP + 1]] = 0;
+    dontLook[route[bestQ]] = 0;
+    dontLook[route[bestQ + 1]] = 0;
+    std::reverse(route.begin() + bestP + 1, route.begin() + bestQ + 1);
+    return bestGain;
+}
+
+// Or-opt: move the segment of 1-3 locations starting at pos between two other neighbouring locations, optionally reversed.
+template <typename Distances>
+static double tryOrOpt(std::vector<int> &route, const size_t pos, const Distances &d, std::vector<unsigned char> &dontLook)
+{
+    const size_t lastCustomer = route.size() - 2;
+
+    double bestGain = minGain;
+    size_t bestLength = 0;
+    size_t bestQ = 0;
+    bool bestReversed = false;
+    for (size_t length = 1; length <= 3 && pos + length - 1 <= lastCustomer; ++length)
+    {
+        const size_t end = pos + length - 1;
+        const int prev = route[pos - 1];
+        const int next = route[end + 1];
+        const int first = route[pos];
+        const int last = route[end];
+        const double removeGain = d(prev, first) + d(last, next) - d(prev, next);
+
+        for (size_t q = 0; q + 1 < route.size(); ++q)
+        {
+            // Skip the edges that touch the segment
+            if (q + 1 >= pos && q <= end)
+            {
+                continue;
+            }
+            const int a = route[q];
+            const int b = route[q + 1];
+            const double base = removeGain + d(a, b);
+
+            double forwardGain = base - d(a, first) - d(last, b);
+            if (forwardGain > bestGain)
+            {
+                bestGain = forwardGain;
+                bestLength = length;
+                bestQ = q;
+                bestReversed = false;
+            }
+
+            double reversedGain = base - d(a, last) - d(first, b);
+            if (length > 1 && reversedGain > bestGain)
+            {
+                bestGain = reversedGain;
+                bestLength = length;
+                bestQ = q;
+                bestReversed = true;
+            }
+        }
+    }
+
+    if (bestLength == 0)
+    {
+        return 0.0;
+    }
+
+    dontLook[route[pos - 1]] = 0;
+    dontLook[route[pos]] = 0;
+    dontLook[route[pos + bestLength - 1]] = 0;
+    dontLook[route[pos + bestLength]] = 0;
+    dontLook[route[bestQ]] = 0;
+    dontLook[route[bestQ + 1]] = 0;
+
+    size_t start;
+    if (bestQ < pos)
+    {
+        std::rotate(route.begin() + bestQ + 1, route.begin() + pos, route.begin() + pos + bestLength);
+        start = bestQ + 1;
+    }
+    else
+    {
+        std::rotate(route.begin() + pos, route.begin() + pos + bestLength, route.begin() + bestQ + 1);
+        start = bestQ + 1 - bestLength;
+    }
+    if (bestReversed)
+    {
+        std::reverse(route.begin() + start, route.begin() + start + bestLength);
+    }
+    return bestGain;
+}
+
+// Swap: exchange the location at pos with any other location in the route.
+template <typename Distances>
+static double trySwap(std::vector<int> &route, const size_t pos, const Distances &d, std::vector<unsigned char> &dontLook)
+{
+    const size_t lastCustomer = route.size() - 2;
+
+    double bestGain = minGain;
+    size_t bestOther = 0;
+    for (size_t other = 1; other <= lastCustomer; ++other)
+    {
+        if (other == pos)
+        {
+            continue;
+        }
+        const size_t i = std::min(pos, other);
+        const size_t j = std::max(pos, other);
+        const int x = route[i];
+        const int y = route[j];
+
+        double gain;
+        if (j == i + 1)
+        {
+            gain = d(route[i - 1], x) + d(y, route[j + 1]) - d(route[i - 1], y) - d(x, route[j + 1]);
+        }
+        else
+        {
+            gain = d(route[i - 1], x) + d(x, route[i + 1]) + d(route[j - 1], y) + d(y, route[j + 1]) -
+                   d(route[i - 1], y) - d(y, route[i + 1]) - d(route[j - 1], x) - d(x, route[j + 1]);
+        }
+        if (gain > bestGain)
+        {
+            bestGain = gain;
+            bestOther = other;
+        }
+    }
+
+    if (bestOther == 0)
+    {
+        return 0.0;
+    }
+
+    const size_t i = std::min(pos, bestOther);
+    const size_t j = std::max(pos, bestOther);
+    dontLook[route[i - 1]] = 0;
+    dontLook[route[i + 1]] = 0;
+    dontLook[route[j - 1]] = 0;
+    dontLook[route[j + 1]] = 0;
+    std::swap(route[i], route[j]);
+    dontLook[route[i]] = 0;
+    dontLook[route[j]] = 0;
+    return bestGain;
+}
+
+/* Intra-route local search
+    - Improves one route (starting and ending at the depot) in place and returns how much shorter it got.
+    - Each move is scored in O(1) from the matrix entries of the edges it removes and adds, which assumes
+      a symmetric distance matrix like the one from getDistanceMatrix.
+    - For each location the 2-opt, Or-opt and swap neighbourhoods are tried in that order and the best move of the first
+      neighbourhood that improves the route is applied.
+    - Don't-look bits: a location is skipped once no improving move starts from it, until a move changes one of its edges.
+      dontLook is indexed by location, must be at least as long as the distance matrix, and is never resized here.
+*/
+template <typename Distances>
+static double improveRouteWith(std::vector<int> &route, const Distances &d, std::vector<unsigned char> &dontLook)
+{
+    // Routes with less than two locations can't be improved
+    if (route.size() < 4)
+    {
+        return 0.0;
+    }
+
+    for (size_t pos = 1; pos < route.size() - 1; ++pos)
+    {
+        dontLook[route[pos]] = 0;
+    }
+
+    double totalGain = 0.0;
+    bool improved = true;
+    while (improved)
+    {
+        improved = false;
+        for (size_t pos = 1; pos < route.size() - 1; ++pos)
+        {
+            const int location = route[pos];
+            if (dontLook[location])
+            {
+                continue;
+            }
+
+            double gain = tryTwoOpt(route, pos, d, dontLook);
+            if (gain == 0.0)
+            {
+                gain = tryOrOpt(route, pos, d, dontLook);
+            }
+            if (gain == 0.0)
+            {
+                gain = trySwap(route, pos, d, dontLook);
+            }
+
+            if (gain > 0.0)
+            {
+                totalGain += gain;
+                improved = true;
+            }
+            else
+            {
+                dontLook[location] = 1;
+            }
+        }
+    }
+
+    return totalGain;
+}
+
+double improveRoute(std::vector<int> &route, const Matrix &distMatrix, std::vector<unsigned char> &dontLook)
+{
+    return withDistances(distMatrix, [&](const auto &d)
+                         { return improveRouteWith(route, d, dontLook); });
+}
+
+void intraRouteSearch(Individual &child, const Matrix &distMatrix)
+{
+    // One buffer per thread so children can be improved in parallel without allocating
+    thread_local std::vector<unsigned char> dontLook;
+    if (dontLook.size() < distMatrix.size())
+    {
+        dontLook.resize(distMatrix.size());
+    }
+
+    // Only the routes that got shorter are measured again
+    const bool lengthsKnown = child.lengths.size() == child.routes.size();
+    for (size_t r = 0; r < child.routes.size(); ++r)
+    {
+        if (improveRoute(child.routes[r], distMatrix, dontLook) > 0.0 && lengthsKnown)
+        {
+            child.lengths[r] = routeDistance(child.routes[r], distMatrix);
+        }
+    }
+}
+
+// Distance between two neighbouring locations of a route. A route that goes from the depot straight
+// back to the depot is empty and will be removed, so that edge costs nothing.
+template <typename Distances>
+static double linkDistance(const Distances &d, const int a, const int b)
+{
+    return (a == 0 && b == 0) ? 0.0 : d(a, b);
+}
+
+// Replaces the oldLength locations of route starting at pos with the newLength locations in segment.
+static void replaceSegment(std::vector<int> &route, const size_t pos, const size_t oldLength, const int *segment, const size_t newLength)
+{
+    if (newLength > oldLength)
+    {
+        route.insert(route.begin() + pos + oldLength, newLength - oldLength, 0);
+    }
+    else if (newLength < oldLength)
+    {
+        route.erase(route.begin() + pos + newLength, route.begin() + pos + oldLength);
+    }
+    std::copy(segment, segment + newLength, route.begin() + pos);
+}
+
+enum class InterMove
+{
+    None,
+    Relocate,
+    Exchange,
+    TwoOptStar,
+    CrossExchange
+};
+
+// Best move found between two routes. i and j are positions in the first and second route,
+// lengthA and lengthB the number of locations each route gives up.
+struct InterMoveCandidate
+{
+    InterMove move = InterMove::None;
+    double gain = minGain;
+    size_t i = 0;
+    size_t j = 0;
+    size_t lengthA = 0;
+    size_t lengthB = 0;
+};
+
+// Relocate: move one location from routeA to any position in routeB.
+template <typename Distances>
+static void findRelocate(const std::vector<int> &routeA, const std::vector<int> &routeB, const Distances &d,
+                         const size_t maxPackages, const bool forward, InterMoveCandidate &best)
+{
+    if (routeB.size() - 2 + 1 > maxPackages)
+    {
+        return;
+    }
+
+    for (size_t i = 1; i < routeA.size() - 1; ++i)
+    {
+        const int u = routeA[i];
+        const double removeGain = d(routeA[i - 1], u) + d(u, routeA[i + 1]) - linkDistance(d, routeA[i - 1], routeA[i + 1]);
+        for (size_t j = 0; j < routeB.size() - 1; ++j)
+        {
+            double gain = removeGain + linkDistance(d, routeB[j], routeB[j + 1]) - d(routeB[j], u) - d(u, routeB[j + 1]);
+            if (gain > best.gain)
+            {
+                best = {InterMove::Relocate, gain, forward ? i : j, forward ? j : i, forward ? 1u : 0u, forward ? 0u : 1u};
+            }
+        }
+    }
+}
+
+// Exchange: swap one location of routeA with one location of routeB.
+template <typename Distances>
+static void findExchange(const std::vector<int> &routeA, const std::vector<int> &routeB, const Distances &d, InterMoveCandidate &best)
+{
+    for (size_t i = 1; i < routeA.size() - 1; ++i)
+    {
+        const int u = routeA[i];
+        const int aPrev = routeA[i - 1];
+        const int aNext = routeA[i + 1];
+        const double removeU = d(aPrev, u) + d(u, aNext);
+        for (size_t j = 1; j < routeB.size() - 1; ++j)
+        {
+            const int v = routeB[j];
+            const int bPrev = routeB[j - 1];
+            const int bNext = routeB[j + 1];
+            double gain = removeU + d(bPrev, v) + d(v, bNext) - d(aPrev, v) - d(v, aNext) - d(bPrev, u) - d(u, bNext);
+            if (gain > best.gain)
+            {
+                best = {InterMove::Exchange, gain, i, j, 1, 1};
+            }
+        }
+    }
+}
+
+// 2-opt*: cut routeA after position i and routeB after position j, then swap the tails.
+template <typename Distances>
+static void findTwoOptStar(const std::vector<int> &routeA, const std::vector<int> &routeB, const Distances &d,
+                           const size_t maxPackages, InterMoveCandidate &best)
+{
+    const size_t customersA = routeA.size() - 2;
+    const size_t customersB = routeB.size() - 2;
+    for (size_t i = 0; i < routeA.size() - 1; ++i)
+    {
+        for (size_t j = 0; j < routeB.size() - 1; ++j)
+        {
+            // The number of locations before each cut is i and j, so the new route sizes follow directly
+            if (i + (customersB - j) > maxPackages || j + (customersA - i) > maxPackages)
+            {
+                continue;
+            }
+            double gain = linkDistance(d, routeA[i], routeA[i + 1]) + linkDistance(d, routeB[j], routeB[j + 1]) -
+                          linkDistance(d, routeA[i], routeB[j + 1]) - linkDistance(d, routeB[j], routeA[i + 1]);
+            if (gain > best.gain)
+            {
+                best = {InterMove::TwoOptStar, gain, i, j, routeA.size() - 1 - i, routeB.size() - 1 - j};
+            }
+        }
+    }
+}
+
+// Cross-exchange: swap a segment of 1-3 locations of routeA with a segment of 1-3 locations of routeB.
+// Swapping two single locations is left to findExchange.
+template <typename Distances>
+static void findCrossExchange(const std::vector<int> &routeA, const std::vector<int> &routeB, const Distances &d,
+                              const size_t maxPackages, InterMoveCandidate &best)
+{
+    const size_t customersA = routeA.size() - 2;
+    const size_t customersB = routeB.size() - 2;
+    for (size_t lengthA = 1; lengthA <= 3 && lengthA <= customersA; ++lengthA)
+    {
+        for (size_t lengthB = 1; lengthB <= 3 && lengthB <= customersB; ++lengthB)
+        {
+            if ((lengthA == 1 && lengthB == 1) ||
+                customersA - lengthA + lengthB > maxPackages ||
+                customersB - lengthB + lengthA > maxPackages)
+            {
+                continue;
+            }
+            for (size_t i = 1; i + lengthA < routeA.size(); ++i)
+            {
+                const int aPrev = routeA[i - 1];
+                const int aFirst = routeA[i];
+                const int aLast = routeA[i + lengthA - 1];
+                const int aNext = routeA[i + lengthA];
+                const double removeA = d(aPrev, aFirst) + d(aLast, aNext);
+                for (size_t j = 1; j + lengthB < routeB.size(); ++j)
+                {
+                    const int bPrev = routeB[j - 1];
+                    const int bFirst = routeB[j];
+                    const int bLast = routeB[j + lengthB - 1];
+                    const int bNext = routeB[j + lengthB];
+                    double gain = removeA + d(bPrev, bFirst) + d(bLast, bNext) -
+                                  d(aPrev, bFirst) - d(bLast, aNext) - d(bPrev, aFirst) - d(aLast, bNext);
+                    if (gain > best.gain)
+                    {
+                        best = {InterMove::CrossExchange, gain, i, j, lengthA, lengthB};
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void applyInterMove(std::vector<int> &routeA, std::vector<int> &routeB, const InterMoveCandidate &best)
+{
+    switch (best.move)
+    {
+    case InterMove::Relocate:
+        if (best.lengthA == 1)
+        {
+            routeB.insert(routeB.begin() + best.j + 1, routeA[best.i]);
+            routeA.erase(routeA.begin() + best.i);
+        }
+        else
+        {
+            routeA.insert(routeA.begin() + best.i + 1, routeB[best.j]);
+            routeB.erase(routeB.begin() + best.j);
+        }
+        break;
+    case InterMove::Exchange:
+        std::swap(routeA[best.i], routeB[best.j]);
+        break;
+    case InterMove::TwoOptStar:
+    {
+        // Swap the common part of the tails in place, then move whatever is left of the longer tail
+        const size_t common = std::min(best.lengthA, best.lengthB);
+        std::swap_ranges(routeA.begin() + best.i + 1, routeA.begin() + best.i + 1 + common, routeB.begin() + best.j + 1);
+        if (best.lengthA > common)
+        {
+            routeB.insert(routeB.end(), routeA.begin() + best.i + 1 + common, routeA.end());
+            routeA.erase(routeA.begin() + best.i + 1 + common, routeA.end());
+        }
+        else if (best.lengthB > common)
+        {
+            routeA.insert(routeA.end(), routeB.begin() + best.j + 1 + common, routeB.end());
+            routeB.erase(routeB.begin() + best.j + 1 + common, routeB.end());
+        }
+        break;
+    }
+    case InterMove::CrossExchange:
+    {
+        int segmentA[3];
+        int segmentB[3];
+        std::copy(routeA.begin() + best.i, routeA.begin() + best.i + best.lengthA, segmentA);
+        std::copy(routeB.begin() + best.j, routeB.begin() + best.j + best.lengthB, segmentB);
+        replaceSegment(routeA, best.i, best.lengthA, segmentB, best.lengthB);
+        replaceSegment(routeB, best.j, best.lengthB, segmentA, best.lengthA);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/* Inter-route local search
+    - Improves a set of routes in place and returns how much shorter they got in total.
+    - Neighbourhoods between each pair of routes: relocate, exchange, 2-opt* (swap route tails) and cross-exchange
+      (swap segments of up to 3 locations). The best move over all of them is applied.
+    - Every route carries one package per location, so the capacity check for a move only needs the route sizes
+      and the positions involved, and each move is scored in O(1) from the distances it changes.
+    - After each applied move both routes get an intra-route search (improveRoute).
+    - A pair of routes is only looked at again once one of them has changed.
+    - Routes that become empty are removed at the end.
+    - With lengths given, the routes a move touched are measured again and lengths follows the removal of routes.
+*/
+template <typename Distances>
+static double improveRoutesWith(std::vector<std::vector<int>> &routes, const Distances &d, const size_t maxPackages, std::vector<unsigned char> &dontLook,
+                                std::vector<double> *lengths)
+{
+    // Route flags live as long as the thread so repeated searches don't allocate
+    thread_local std::vector<unsigned char> changed;
+    thread_local std::vector<unsigned char> changedThisPass;
+    thread_local std::vector<unsigned char> touched;
+
+    // Moves grow routes up to maxPackages, reserve that up front so they never reallocate
+    for (auto &route : routes)
+    {
+        route.reserve(maxPackages + 2);
+    }
+
+    double totalGain = 0.0;
+    changed.assign(routes.size(), 1);
+    touched.assign(routes.size(), 0);
+    bool improved = true;
+    while (improved)
+    {
+        improved = false;
+        changedThisPass.assign(routes.size(), 0);
+        for (size_t a = 0; a < routes.size(); ++a)
+        {
+            for (size_t b = a + 1; b < routes.size(); ++b)
+            {
+                if (!changed[a] && !changed[b])
+                {
+                    continue;
+                }
+
+                InterMoveCandidate best;
+                findRelocate(routes[a], routes[b], d, maxPackages, true, best);
+                findRelocate(routes[b], routes[a], d, maxPackages, false, best);
+                findExchange(routes[a], routes[b], d, best);
+                findTwoOptStar(routes[a], routes[b], d, maxPackages, best);
+                findCrossExchange(routes[a], routes[b], d, maxPackages, best);
+                if (best.move == InterMove::None)
+                {
+                    continue;
+                }
+
+                applyInterMove(routes[a], routes[b], best);
+                totalGain += best.gain;
+                totalGain += improveRouteWith(routes[a], d, dontLook);
+                totalGain += improveRouteWith(routes[b], d, dontLook);
+                changedThisPass[a] = 1;
+                changedThisPass[b] = 1;
+                touched[a] = 1;
+                touched[b] = 1;
+                improved = true;
+            }
+        }
+        std::swap(changed, changedThisPass);
+    }
+
+    // Remove the emptied routes, keeping the order of the others. Their vectors go back to the route pool.
+    size_t kept = 0;
+    for (size_t r = 0; r < routes.size(); ++r)
+    {
+        if (routes[r].size() > 2)
+        {
+            if (lengths != nullptr)
+            {
+                (*lengths)[kept] = touched[r] ? routeDistanceWith(routes[r], d) : (*lengths)[r];
+            }
+            std::swap(routes[kept], routes[r]);
+            ++kept;
+        }
+    }
+    releaseRoutes(routes, kept);
+    if (lengths != nullptr)
+    {
+        lengths->resize(kept);
+    }
+    return totalGain;
+}
+
+double improveRoutes(std::vector<std::vector<int>> &routes, const Matrix &distMatrix, const size_t maxPackages, std::vector<unsigned char> &dontLook,
+                     std::vector<double> *lengths)
+{
+    return withDistances(distMatrix, [&](const auto &d)
+                         { return improveRoutesWith(routes, d, maxPackages, dontLook, lengths); });
+}
+
+void interRouteSearch(Individual &child, const Matrix &distMatrix, const size_t maxPackages)
+{
+    thread_local std::vector<unsigned char> dontLook;
+    if (dontLook.size() < distMatrix.size())
+    {
+        dontLook.resize(distMatrix.size());
+    }
+
+    const bool lengthsKnown = child.lengths.size() == child.routes.size();
+    for (size_t r = 0; r < child.routes.size(); ++r)
+    {
+        if (improveRoute(child.routes[r], distMatrix, dontLook) > 0.0 && lengthsKnown)
+        {
+            child.lengths[r] = routeDistance(child.routes[r], distMatrix);
+        }
+    }
+    improveRoutes(child.routes, distMatrix, maxPackages, dontLook, lengthsKnown ? &child.lengths : nullptr);
+}
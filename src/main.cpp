@@ -44,7 +44,7 @@ int main()
         locations_y.push_back(customer.y);
     }
 
-    std::vector<std::vector<std::vector<int>>> clarkeWrightProgression = completeSolverClarkeWright(
+    RoutesProgress clarkeWrightProgression = completeSolverClarkeWright(
         centerCoords,
         centerCoords,
         locations_x,
@@ -53,7 +53,7 @@ int main()
         true,
         exportFile);
 
-    std::vector<std::vector<std::vector<int>>> geneticSolution = completeSolverGenetic(
+    GeneticResult geneticSolution = completeSolverGenetic(
         centerCoords,
         centerCoords,
         locations_x,
@@ -0,0 +1,292 @@
+#include "routes_progress.h"
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+RoutesProgress::RoutesProgress(const bool recordHistory)
+    : recordHistory(recordHistory), keyframeRoutes{0}, routeOffsets{0}
+{
+}
+
+bool RoutesProgress::recordsHistory() const
+{
+    return recordHistory;
+}
+
+size_t RoutesProgress::size() const
+{
+    return events.size();
+}
+
+bool RoutesProgress::empty() const
+{
+    return events.empty();
+}
+
+// Records all routes. The depot is left out and added back when the frame is rebuilt.
+void RoutesProgress::keyframe(const std::vector<std::vector<int>> &routes)
+{
+    if (!recordHistory)
+    {
+        events.clear();
+        keyframeEvents.clear();
+        keyframeRoutes.assign(1, 0);
+        routeOffsets.assign(1, 0);
+        keyframeCustomers.clear();
+    }
+
+    keyframeEvents.push_back(events.size());
+    events.push_back({ProgressStep::Keyframe, false, false, static_cast<int>(keyframeRoutes.size() - 1), 0});
+    for (const auto &route : routes)
+    {
+        for (int customer : route)
+        {
+            if (customer != 0)
+            {
+                keyframeCustomers.push_back(customer);
+            }
+        }
+        routeOffsets.push_back(keyframeCustomers.size());
+    }
+    keyframeRoutes.push_back(routeOffsets.size() - 1);
+}
+
+void RoutesProgress::newRoute(const int first, const int second)
+{
+    if (recordHistory)
+    {
+        events.push_back({ProgressStep::NewRoute, false, false, first, second});
+    }
+}
+
+void RoutesProgress::addToFront(const int route, const int customer)
+{
+    if (recordHistory)
+    {
+        events.push_back({ProgressStep::AddToFront, false, false, route, customer});
+    }
+}
+
+void RoutesProgress::addToBack(const int route, const int customer)
+{
+    if (recordHistory)
+    {
+        events.push_back({ProgressStep::AddToBack, false, false, route, customer});
+    }
+}
+
+void RoutesProgress::join(const int route, const int joinedRoute, const bool joinedFirst, const bool reverseJoined)
+{
+    if (recordHistory)
+    {
+        events.push_back({ProgressStep::Join, joinedFirst, reverseJoined, route, joinedRoute});
+    }
+}
+
+// Replaces every customer c with ids[c], e.g. to give routes solved on reordered customers the caller's numbers.
+// ids[0] must be 0 so the depot stays the depot.
+void RoutesProgress::renumber(const std::vector<int> &ids)
+{
+    for (int &customer : keyframeCustomers)
+    {
+        customer = ids[customer];
+    }
+    for (auto &event : events)
+    {
+        switch (event.step)
+        {
+        case ProgressStep::NewRoute:
+            event.a = ids[event.a];
+            event.b = ids[event.b];
+            break;
+        case ProgressStep::AddToFront:
+        case ProgressStep::AddToBack:
+            event.b = ids[event.b];
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+std::vector<std::vector<int>> RoutesProgress::frame(const size_t index) const
+{
+    if (index >= events.size())
+    {
+        throw std::out_of_range("frame " + std::to_string(index) + " of a progress with " + std::to_string(events.size()) + " frames");
+    }
+    ProgressCursor cursor(*this);
+    cursor.seek(index);
+    return cursor.routes();
+}
+
+std::vector<std::vector<int>> RoutesProgress::back() const
+{
+    if (events.empty())
+    {
+        throw std::out_of_range("progress has no frames");
+    }
+    return frame(events.size() - 1);
+}
+
+// Rebuilds every frame, the same as the old one-copy-per-step representation.
+std::vector<std::vector<std::vector<int>>> RoutesProgress::frames() const
+{
+    std::vector<std::vector<std::vector<int>>> allFrames;
+    allFrames.reserve(events.size());
+    ProgressCursor cursor(*this);
+    while (cursor.next())
+    {
+        allFrames.push_back(cursor.routes());
+    }
+    return allFrames;
+}
+
+FlatFrames RoutesProgress::flatFrames() const
+{
+    return flatFrames(0, events.size());
+}
+
+// Frames [first, last) without building a vector per route, e.g. flatFrames(size() - 1, size()) for the final routes.
+FlatFrames RoutesProgress::flatFrames(const size_t first, const size_t last) const
+{
+    if (first > last || last > events.size())
+    {
+        throw std::out_of_range("frames " + std::to_string(first) + " to " + std::to_string(last) + " of a progress with " + std::to_string(events.size()) + " frames");
+    }
+
+    FlatFrames flat;
+    if (first == last)
+    {
+        return flat;
+    }
+    ProgressCursor cursor(*this);
+    cursor.seek(first);
+    for (size_t index = first; index < last; ++index)
+    {
+        if (index > first)
+        {
+            cursor.next();
+        }
+        cursor.appendRoutes(flat.customers, flat.routeOffsets);
+        flat.frameOffsets.push_back(flat.routeOffsets.size() - 1);
+    }
+    return flat;
+}
+
+ProgressCursor::ProgressCursor(const RoutesProgress &progress)
+    : progress(&progress), nextEvent(0)
+{
+}
+
+bool ProgressCursor::next()
+{
+    if (nextEvent >= progress->events.size())
+    {
+        return false;
+    }
+    apply(progress->events[nextEvent++]);
+    return true;
+}
+
+// Moves to frame index, replaying from the closest keyframe before it unless the cursor is already on the way there.
+void ProgressCursor::seek(const size_t index)
+{
+    const auto &keyframeEvents = progress->keyframeEvents;
+    auto keyframe = std::upper_bound(keyframeEvents.begin(), keyframeEvents.end(), index);
+    size_t start = keyframe == keyframeEvents.begin() ? 0 : *(keyframe - 1);
+
+    if (nextEvent == 0 || nextEvent - 1 < start || nextEvent - 1 > index)
+    {
+        state.clear();
+        alive.clear();
+        nextEvent = start;
+    }
+    while (nextEvent <= index && next())
+    {
+    }
+}
+
+// The routes of the current frame, each starting and ending with the depot.
+std::vector<std::vector<int>> ProgressCursor::routes() const
+{
+    std::vector<std::vector<int>> routes;
+    for (size_t route = 0; route < state.size(); ++route)
+    {
+        if (!alive[route])
+        {
+            continue;
+        }
+        std::vector<int> points;
+        points.reserve(state[route].size() + 2);
+        points.push_back(0);
+        points.insert(points.end(), state[route].begin(), state[route].end());
+        points.push_back(0);
+        routes.push_back(std::move(points));
+    }
+    return routes;
+}
+
+// Appends the routes of the current frame in the FlatFrames layout, routeOffsets must already end with customers.size().
+void ProgressCursor::appendRoutes(std::vector<int> &customers, std::vector<size_t> &routeOffsets) const
+{
+    for (size_t route = 0; route < state.size(); ++route)
+    {
+        if (!alive[route])
+        {
+            continue;
+        }
+        customers.push_back(0);
+        customers.insert(customers.end(), state[route].begin(), state[route].end());
+        customers.push_back(0);
+        routeOffsets.push_back(customers.size());
+    }
+}
+
+void ProgressCursor::apply(const ProgressEvent &event)
+{
+    switch (event.step)
+    {
+    case ProgressStep::Keyframe:
+    {
+        state.clear();
+        alive.clear();
+        const auto &routeOffsets = progress->routeOffsets;
+        const auto &customers = progress->keyframeCustomers;
+        for (size_t route = progress->keyframeRoutes[event.a]; route < progress->keyframeRoutes[event.a + 1]; ++route)
+        {
+            state.emplace_back(customers.begin() + routeOffsets[route], customers.begin() + routeOffsets[route + 1]);
+            alive.push_back(true);
+        }
+        break;
+    }
+    case ProgressStep::NewRoute:
+        state.push_back({event.a});
+        if (event.b != 0)
+        {
+            state.back().push_back(event.b);
+        }
+        alive.push_back(true);
+        break;
+    case ProgressStep::AddToFront:
+        state[event.a].insert(state[event.a].begin(), event.b);
+        break;
+    case ProgressStep::AddToBack:
+        state[event.a].push_back(event.b);
+        break;
+    case ProgressStep::Join:
+    {
+        std::vector<int> &route = state[event.a];
+        std::vector<int> &joined = state[event.b];
+        if (event.reverseJoined)
+        {
+            std::reverse(joined.begin(), joined.end());
+        }
+        route.insert(event.joinedFirst ? route.begin() : route.end(), joined.begin(), joined.end());
+        std::vector<int>().swap(joined);
+        alive[event.b] = false;
+        break;
+    }
+    }
+}
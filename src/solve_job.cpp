@@ -0,0 +1,82 @@
+#include "solve_job.h"
+#include <chrono>
+#include <utility>
+
+SolveJob::SolveJob(std::function<GeneticResult(SolveMonitor &)> solve)
+    : worker([this, solve = std::move(solve)]()
+             {
+                 GeneticResult result{RoutesProgress(), StopReason::MaxGenerations, 0};
+                 std::exception_ptr thrown;
+                 try
+                 {
+                     result = solve(monitor);
+                 }
+                 catch (...)
+                 {
+                     thrown = std::current_exception();
+                 }
+
+                 std::lock_guard<std::mutex> lock(mutex);
+                 outcome = std::move(result);
+                 error = thrown;
+                 isDone = true;
+                 finished.notify_all(); })
+{
+}
+
+SolveJob::~SolveJob()
+{
+    cancel();
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+}
+
+// Only asks the solver to stop, it finishes its current generation first. Use wait() or result() to wait for that.
+void SolveJob::cancel()
+{
+    monitor.cancelled.store(true, std::memory_order_relaxed);
+}
+
+bool SolveJob::done() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return isDone;
+}
+
+void SolveJob::wait() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this]()
+                  { return isDone; });
+}
+
+// Returns whether the job finished within seconds.
+bool SolveJob::waitFor(const double seconds) const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return finished.wait_for(lock, std::chrono::duration<double>(seconds), [this]()
+                             { return isDone; });
+}
+
+size_t SolveJob::generation() const
+{
+    return monitor.generation.load(std::memory_order_relaxed);
+}
+
+// The shortest total distance found so far, infinity until the first generation exists.
+double SolveJob::bestDistance() const
+{
+    return monitor.bestDistance.load(std::memory_order_relaxed);
+}
+
+const GeneticResult &SolveJob::result() const
+{
+    wait();
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    return outcome;
+}
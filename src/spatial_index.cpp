@@ -0,0 +1,360 @@
+#include "spatial_index.h"
+#include "utils.h"
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+
+// Recursively orders order[lo, hi) so the median along the wider side of the range sits in the middle.
+static void buildRange(KdTree &tree, std::vector<int> &order, const std::vector<Point> &points, const size_t lo, const size_t hi)
+{
+    if (hi - lo <= 1)
+    {
+        return;
+    }
+
+    double minX = points[order[lo]].x;
+    double maxX = minX;
+    double minY = points[order[lo]].y;
+    double maxY = minY;
+    for (size_t i = lo + 1; i < hi; ++i)
+    {
+        minX = std::min(minX, points[order[i]].x);
+        maxX = std::max(maxX, points[order[i]].x);
+        minY = std::min(minY, points[order[i]].y);
+        maxY = std::max(maxY, points[order[i]].y);
+    }
+
+    const size_t mid = (lo + hi) / 2;
+    const unsigned char axis = (maxX - minX >= maxY - minY) ? 0 : 1;
+    std::nth_element(order.begin() + lo, order.begin() + mid, order.begin() + hi, [&](int a, int b)
+                     { return axis == 0 ? points[a].x < points[b].x : points[a].y < points[b].y; });
+    tree.axis[mid] = axis;
+
+    buildRange(tree, order, points, lo, mid);
+    buildRange(tree, order, points, mid + 1, hi);
+}
+
+// Builds a tree over points, where ids[i] is the location index reported for points[i].
+KdTree buildKdTree(const std::vector<Point> &points, const std::vector<int> &ids)
+{
+    KdTree tree;
+    tree.axis.assign(points.size(), 0);
+
+    std::vector<int> order(points.size());
+    std::iota(order.begin(), order.end(), 0);
+    buildRange(tree, order, points, 0, points.size());
+
+    tree.points.reserve(points.size());
+    tree.ids.reserve(points.size());
+    for (int i : order)
+    {
+        tree.points.push_back(points[i]);
+        tree.ids.push_back(ids[i]);
+    }
+    return tree;
+}
+
+// Keeps the k closest points seen so far in a max-heap on squared distance.
+static void searchRange(const KdTree &tree, const size_t lo, const size_t hi, const Point &query, const size_t k, const int exclude,
+                        std::vector<std::pair<double, int>> &heap)
+{
+    if (lo >= hi)
+    {
+        return;
+    }
+
+    const size_t mid = (lo + hi) / 2;
+    const Point &point = tree.points[mid];
+    if (tree.ids[mid] != exclude)
+    {
+        double x_dist = point.x - query.x;
+        double y_dist = point.y - query.y;
+        std::pair<double, int> candidate = {x_dist * x_dist + y_dist * y_dist, tree.ids[mid]};
+        if (heap.size() < k)
+        {
+            heap.push_back(candidate);
+            std::push_heap(heap.begin(), heap.end());
+        }
+        else if (candidate < heap.front())
+        {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = candidate;
+            std::push_heap(heap.begin(), heap.end());
+        }
+    }
+
+    // Search the side of the split the query is on first, the other side only if it can still hold a closer point
+    const double splitDistance = tree.axis[mid] == 0 ? query.x - point.x : query.y - point.y;
+    const bool queryIsLow = splitDistance < 0;
+    searchRange(tree, queryIsLow ? lo : mid + 1, queryIsLow ? mid : hi, query, k, exclude, heap);
+    if (heap.size() < k || splitDistance * splitDistance < heap.front().first)
+    {
+        searchRange(tree, queryIsLow ? mid + 1 : lo, queryIsLow ? hi : mid, query, k, exclude, heap);
+    }
+}
+
+// Writes the ids of the k points closest to query into result, nearest first. The point with id exclude is skipped.
+void kNearest(const KdTree &tree, const Point &query, const size_t k, const int exclude, std::vector<int> &result)
+{
+    thread_local std::vector<std::pair<double, int>> heap;
+    heap.clear();
+    result.clear();
+    if (k == 0)
+    {
+        return;
+    }
+
+    searchRange(tree, 0, tree.points.size(), query, k, exclude, heap);
+    std::sort_heap(heap.begin(), heap.end());
+    for (const auto &[distance, id] : heap)
+    {
+        result.push_back(id);
+    }
+}
+
+RemovableKdTree::RemovableKdTree(KdTree tree)
+    : tree(std::move(tree))
+{
+    const size_t n = this->tree.points.size();
+    alive.assign(n, 1);
+    aliveBelow.assign(n, 0);
+    int maxId = -1;
+    for (int id : this->tree.ids)
+    {
+        maxId = std::max(maxId, id);
+    }
+    positionOf.assign(maxId + 1, 0);
+    for (size_t position = 0; position < n; ++position)
+    {
+        positionOf[this->tree.ids[position]] = position;
+    }
+
+    // The node of [lo, hi) holds hi - lo points, filled in for every node by walking the ranges
+    std::vector<std::pair<size_t, size_t>> ranges = {{0, n}};
+    while (!ranges.empty())
+    {
+        auto [lo, hi] = ranges.back();
+        ranges.pop_back();
+        if (lo >= hi)
+        {
+            continue;
+        }
+        const size_t mid = (lo + hi) / 2;
+        aliveBelow[mid] = static_cast<int>(hi - lo);
+        ranges.push_back({lo, mid});
+        ranges.push_back({mid + 1, hi});
+    }
+}
+
+bool RemovableKdTree::empty() const
+{
+    return tree.points.empty() || aliveBelow[tree.points.size() / 2] == 0;
+}
+
+void RemovableKdTree::remove(const int id)
+{
+    const size_t position = positionOf[id];
+    size_t lo = 0;
+    size_t hi = tree.points.size();
+    while (lo < hi)
+    {
+        const size_t mid = (lo + hi) / 2;
+        --aliveBelow[mid];
+        if (position == mid)
+        {
+            alive[mid] = 0;
+            return;
+        }
+        if (position < mid)
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+}
+
+// Keeps the closest alive point seen so far, the lowest id among equally close ones.
+template <typename Distances>
+static void searchNearest(const KdTree &tree, const std::vector<int> &aliveBelow, const std::vector<char> &alive, const size_t lo, const size_t hi,
+                          const Distances &d, const int from, const Point &query, double &bestDistance, int &bestId)
+{
+    if (lo >= hi)
+    {
+        return;
+    }
+    const size_t mid = (lo + hi) / 2;
+    if (aliveBelow[mid] == 0)
+    {
+        return;
+    }
+
+    if (alive[mid])
+    {
+        const double distance = d(from, tree.ids[mid]);
+        if (bestId == -1 || distance < bestDistance || (distance == bestDistance && tree.ids[mid] < bestId))
+        {
+            bestDistance = distance;
+            bestId = tree.ids[mid];
+        }
+    }
+
+    // The other side of the split can only hold a point at least splitDistance away
+    const Point &point = tree.points[mid];
+    const double splitDistance = tree.axis[mid] == 0 ? query.x - point.x : query.y - point.y;
+    const bool queryIsLow = splitDistance < 0;
+    searchNearest(tree, aliveBelow, alive, queryIsLow ? lo : mid + 1, queryIsLow ? mid : hi, d, from, query, bestDistance, bestId);
+    if (std::abs(splitDistance) <= bestDistance)
+    {
+        searchNearest(tree, aliveBelow, alive, queryIsLow ? mid + 1 : lo, queryIsLow ? hi : mid, d, from, query, bestDistance, bestId);
+    }
+}
+
+// The alive point closest to location from of distMatrix, -1 when none is left. Distances are read from the matrix,
+// the locations of distMatrix only decide which branches are searched.
+int RemovableKdTree::nearest(const Matrix &distMatrix, const int from) const
+{
+    double bestDistance = std::numeric_limits<double>::infinity();
+    int bestId = -1;
+    withDistances(distMatrix, [&](const auto &d)
+                  { searchNearest(tree, aliveBelow, alive, 0, tree.points.size(), d, from, distMatrix.locations[from], bestDistance, bestId); });
+    return bestId;
+}
+
+/* Granular neighbour lists
+    - Returns the numNeighbours closest customers of every customer in one flat vector: entries
+      [(i - 1) * numNeighbours, i * numNeighbours) belong to customer i, nearest first.
+    - numNeighbours is capped at the number of other customers.
+    - Uses a k-d tree over the matrix locations when they are known, otherwise partially sorts each matrix row.
+*/
+std::vector<int> getNeighbourLists(const Matrix &distMatrix, const size_t numNeighbours)
+{
+    const int numCustomers = static_cast<int>(distMatrix.size()) - 1;
+    if (numCustomers <= 0)
+    {
+        return {};
+    }
+    const size_t k = std::min(numNeighbours, static_cast<size_t>(numCustomers - 1));
+    std::vector<int> neighbours(static_cast<size_t>(numCustomers) * k);
+
+    if (distMatrix.locations.size() == distMatrix.size())
+    {
+        std::vector<Point> customers(distMatrix.locations.begin() + 1, distMatrix.locations.end());
+        std::vector<int> ids(numCustomers);
+        std::iota(ids.begin(), ids.end(), 1);
+        KdTree tree = buildKdTree(customers, ids);
+
+#pragma omp parallel
+        {
+            std::vector<int> nearest;
+            nearest.reserve(k);
+#pragma omp for schedule(static)
+            for (int i = 1; i <= numCustomers; ++i)
+            {
+                kNearest(tree, distMatrix.locations[i], k, i, nearest);
+                std::copy(nearest.begin(), nearest.end(), neighbours.begin() + (i - 1) * k);
+            }
+        }
+        return neighbours;
+    }
+
+#pragma omp parallel
+    {
+        std::vector<int> candidates;
+        candidates.reserve(numCustomers);
+        std::vector<double> buffer(numCustomers + 1);
+#pragma omp for schedule(static)
+        for (int i = 1; i <= numCustomers; ++i)
+        {
+            const double *row = distMatrix.row(i, 0, numCustomers + 1, buffer.data());
+            candidates.clear();
+            for (int j = 1; j <= numCustomers; ++j)
+            {
+                if (j != i)
+                {
+                    candidates.push_back(j);
+                }
+            }
+            std::partial_sort(candidates.begin(), candidates.begin() + k, candidates.end(), [row](int a, int b)
+                              { return row[a] < row[b] || (row[a] == row[b] && a < b); });
+            std::copy(candidates.begin(), candidates.begin() + k, neighbours.begin() + (i - 1) * k);
+        }
+    }
+    return neighbours;
+}
+
+// Position of the cell (x, y) along a Hilbert curve that fills a hilbertGrid x hilbertGrid grid.
+static const std::uint32_t hilbertGrid = 1u << 16;
+
+static std::uint32_t hilbertIndex(std::uint32_t x, std::uint32_t y)
+{
+    std::uint32_t index = 0;
+    for (std::uint32_t side = hilbertGrid / 2; side > 0; side /= 2)
+    {
+        const std::uint32_t rx = (x & side) > 0;
+        const std::uint32_t ry = (y & side) > 0;
+        index += side * side * ((3 * rx) ^ ry);
+
+        // Rotate the quadrant so the curve inside it starts and ends at the right corners
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = hilbertGrid - 1 - x;
+                y = hilbertGrid - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return index;
+}
+
+/* Spatial order of the points along a Hilbert curve
+    - Returns the indices of points in the order the curve visits them, so points next to each other in the
+      order are close to each other in the plane.
+    - The bounding box of the points is split into a 65536 x 65536 grid, points in the same cell keep their order.
+*/
+std::vector<int> hilbertOrder(const std::vector<Point> &points)
+{
+    std::vector<int> order(points.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (points.size() < 3)
+    {
+        return order;
+    }
+
+    double minX = points[0].x;
+    double maxX = minX;
+    double minY = points[0].y;
+    double maxY = minY;
+    for (const auto &point : points)
+    {
+        minX = std::min(minX, point.x);
+        maxX = std::max(maxX, point.x);
+        minY = std::min(minY, point.y);
+        maxY = std::max(maxY, point.y);
+    }
+    const double side = std::max(maxX - minX, maxY - minY);
+    const double scale = side > 0.0 ? (hilbertGrid - 1) / side : 0.0;
+
+    std::vector<std::pair<std::uint32_t, int>> keys;
+    keys.reserve(points.size());
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        const auto x = static_cast<std::uint32_t>((points[i].x - minX) * scale);
+        const auto y = static_cast<std::uint32_t>((points[i].y - minY) * scale);
+        keys.push_back({hilbertIndex(x, y), static_cast<int>(i)});
+    }
+    std::sort(keys.begin(), keys.end());
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        order[i] = keys[i].second;
+    }
+    return order;
+}
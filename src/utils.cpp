@@ -1,9 +1,12 @@
 #include "utils.h"
+#include "routes_progress.h"
 #include <vector>
 #include <random>
 #include <cmath>
 #include <string>
 #include <fstream>
+#include <stdexcept>
+#include <algorithm>
 
 // For writing Point types to csv
 std::ostream &operator<<(std::ostream &os, const Point &point)
@@ -14,13 +17,19 @@ std::ostream &operator<<(std::ostream &os, const Point &point)
 
 // Generates random points within a given area range.
 std::vector<Point> getRandomPoints(const size_t numPoints, const double minDistance, const double maxDistance)
+{
+    std::random_device rd;
+    return getRandomPoints(numPoints, minDistance, maxDistance, rd());
+}
+
+// Same as above but repeatable, for benchmarks that compare solvers on the same instance.
+std::vector<Point> getRandomPoints(const size_t numPoints, const double minDistance, const double maxDistance, const unsigned int seed)
 {
     std::vector<Point> points;
     points.reserve(numPoints);
 
     // rng
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937 gen(seed);
     std::uniform_real_distribution<double> dist(minDistance, maxDistance);
 
     for (int i = 0; i < numPoints; i++)
@@ -31,52 +40,285 @@ std::vector<Point> getRandomPoints(const size_t numPoints, const double minDista
     return points;
 }
 
+// Side of the square tiles fillSymmetric works on, a tile of doubles and its mirror stay in the L1 and L2 caches.
+static const size_t matrixTile = 64;
+
+// Writes convert(distance(i, j)) to out[j - first] for j in [first, last). The loop has no branches, so the compiler
+// vectorises it for the instruction set it targets: SSE2 by default, AVX2 or AVX-512 with VRP_NATIVE_ARCH.
+template <typename T, typename Convert>
+static void fillRow(const double *xs, const double *ys, const size_t i, const size_t first, const size_t last, T *out,
+                    const Convert &convert)
+{
+    const double x = xs[i];
+    const double y = ys[i];
+#pragma omp simd
+    for (size_t j = first; j < last; ++j)
+    {
+        const double x_dist = xs[j] - x;
+        const double y_dist = ys[j] - y;
+        out[j - first] = convert(std::sqrt((x_dist * x_dist) + (y_dist * y_dist)));
+    }
+}
+
+// Going from one location to itself or from one depot to another depot is not a valid path. The builders set these
+// after their hot loops instead of checking every pair.
+template <typename T>
+static void fillInvalid(const size_t n, const int numDepots, T *out, const T infinity)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        out[i * n + i] = infinity;
+    }
+    for (int i = 0; i < numDepots; i++)
+    {
+        std::fill(out + i * n, out + i * n + numDepots, infinity);
+    }
+}
+
+// Fills the square matrix out, n = xs.size(), with convert(distance(i, j)) one whole row at a time, rows are shared
+// out between the threads. Used when convert is cheap: a vectorised square root costs less than reading the mirrored
+// value back, so computing both triangles is faster than fillSymmetric.
+template <typename T, typename Convert>
+static void fillSquare(const std::vector<double> &xs, const std::vector<double> &ys, const int numDepots, T *out,
+                       const T infinity, const Convert &convert)
+{
+    const size_t n = xs.size();
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < static_cast<int>(n); i++)
+    {
+        fillRow(xs.data(), ys.data(), i, 0, n, out + i * n, convert);
+    }
+    fillInvalid(n, numDepots, out, infinity);
+}
+
+/* Same as fillSquare but only the lower triangle is computed, for when convert is expensive
+    - The triangle is split into tiles of matrixTile x matrixTile and each tile is mirrored into the upper triangle
+      right after it is computed, while it is still in cache.
+    - The rows of tiles are shared out between the threads, later rows hold more tiles so they are handed out
+      dynamically.
+*/
+template <typename T, typename Convert>
+static void fillSymmetric(const std::vector<double> &xs, const std::vector<double> &ys, const int numDepots, T *out,
+                          const T infinity, const Convert &convert)
+{
+    const size_t n = xs.size();
+    const int numTiles = static_cast<int>((n + matrixTile - 1) / matrixTile);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int tileRow = 0; tileRow < numTiles; tileRow++)
+    {
+        const size_t rowFirst = tileRow * matrixTile;
+        const size_t rowLast = std::min(n, rowFirst + matrixTile);
+        for (size_t colFirst = 0; colFirst <= rowFirst; colFirst += matrixTile)
+        {
+            const size_t colLast = std::min(rowLast, colFirst + matrixTile);
+            for (size_t i = rowFirst; i < rowLast; ++i)
+            {
+                const size_t last = std::min(i, colLast);
+                if (last > colFirst)
+                {
+                    fillRow(xs.data(), ys.data(), i, colFirst, last, out + i * n + colFirst, convert);
+                }
+            }
+            // Mirror column by column, so the writes run along the rows of the upper triangle
+            for (size_t j = colFirst; j < colLast; ++j)
+            {
+                T *row = out + j * n;
+                for (size_t i = std::max(rowFirst, j + 1); i < rowLast; ++i)
+                {
+                    row[i] = out[i * n + j];
+                }
+            }
+        }
+    }
+    fillInvalid(n, numDepots, out, infinity);
+}
+
 // Generates a square distance matrix where the value at row i and col j is the distance between points i and j.
-Matrix getDistanceMatrix(const std::vector<Point> &depots, const std::vector<Point> &customers)
+// The distances are kept in the given storage, see MatrixStorage.
+Matrix getDistanceMatrix(const std::vector<Point> &depots, const std::vector<Point> &customers, const MatrixStorage storage)
 {
     int numDepots = depots.size();
     int numCustomers = customers.size();
     int matrixSize = numDepots + numCustomers;
 
     Matrix distanceMatrix;
-    distanceMatrix.data = std::vector<double>(matrixSize * matrixSize, 0.0);
-    distanceMatrix.rows = std::vector<double *>(matrixSize);
-
-    for (int i = 0; i < matrixSize; ++i)
+    if (storage == MatrixStorage::Coordinates)
     {
-        distanceMatrix.rows[i] = &distanceMatrix.data[i * matrixSize];
+        if (numDepots != 1)
+        {
+            throw std::invalid_argument("Coordinates storage needs exactly one depot, got: " + std::to_string(numDepots));
+        }
+        distanceMatrix.storage = MatrixStorage::Coordinates;
+        distanceMatrix.locations.reserve(matrixSize);
+        distanceMatrix.locations.insert(distanceMatrix.locations.end(), depots.begin(), depots.end());
+        distanceMatrix.locations.insert(distanceMatrix.locations.end(), customers.begin(), customers.end());
+        distanceMatrix.xs.reserve(matrixSize);
+        distanceMatrix.ys.reserve(matrixSize);
+        for (const auto &location : distanceMatrix.locations)
+        {
+            distanceMatrix.xs.push_back(location.x);
+            distanceMatrix.ys.push_back(location.y);
+        }
+        return distanceMatrix;
+    }
+    if (storage >= MatrixStorage::COUNT)
+    {
+        throw std::invalid_argument("Matrix storage must be Dense, Coordinates, PackedTriangular, Float32 or FixedPoint");
     }
 
     // Combine all points into one vec for iteration
-    std::vector<Point> allLocations;
+    std::vector<Point> &allLocations = distanceMatrix.locations;
     allLocations.reserve(matrixSize);
     allLocations.insert(allLocations.end(), depots.begin(), depots.end());
     allLocations.insert(allLocations.end(), customers.begin(), customers.end());
 
-    // Fill the matrix with the distances between locations
-    for (int i = 0; i < matrixSize; i++)
+    // Separate x and y arrays so the builders can read them with vector loads
+    const size_t n = matrixSize;
+    std::vector<double> xs(n);
+    std::vector<double> ys(n);
+    for (size_t i = 0; i < n; ++i)
     {
-        for (int j = 0; j < matrixSize; j++)
+        xs[i] = allLocations[i].x;
+        ys[i] = allLocations[i].y;
+    }
+    const double infinity = std::numeric_limits<double>::infinity();
+
+    distanceMatrix.storage = storage;
+    if (storage == MatrixStorage::PackedTriangular)
+    {
+        distanceMatrix.data.resize(n * (n - 1) / 2);
+        distanceMatrix.rows = std::vector<double *>(matrixSize);
+        for (size_t i = 0; i < n; ++i)
         {
-            if (i == j)
-            {
-                // Going from one location to itself is not a valid path
-                distanceMatrix.rows[i][j] = std::numeric_limits<double>::infinity();
-            }
-            else if (i < numDepots && j < numDepots)
-            {
-                // Going from one depot to another depot is not a valid path
-                distanceMatrix.rows[i][j] = std::numeric_limits<double>::infinity();
-            }
-            else
+            distanceMatrix.rows[i] = distanceMatrix.data.data() + i * (i - 1) / 2;
+        }
+        // Row i holds i distances, small chunks keep the threads evenly loaded
+#pragma omp parallel for schedule(dynamic, 64)
+        for (int i = 1; i < matrixSize; i++)
+        {
+            fillRow(xs.data(), ys.data(), i, 0, i, distanceMatrix.rows[i], [](const double value)
+                    { return value; });
+        }
+        for (int i = 1; i < numDepots; i++)
+        {
+            std::fill(distanceMatrix.rows[i], distanceMatrix.rows[i] + i, infinity);
+        }
+        return distanceMatrix;
+    }
+    if (storage == MatrixStorage::Float32)
+    {
+        distanceMatrix.floatData.resize(n * n);
+        fillSquare(xs, ys, numDepots, distanceMatrix.floatData.data(), std::numeric_limits<float>::infinity(), [](const double value)
+                      { return static_cast<float>(value); });
+        return distanceMatrix;
+    }
+    if (storage == MatrixStorage::FixedPoint)
+    {
+        // The longest distance gets the largest value that is not infinity. Depot to depot pairs do not count, so
+        // only the rows of the customers are searched, and the root is taken once of the longest squared distance.
+        double longest = 0.0;
+#pragma omp parallel for schedule(dynamic, 64) reduction(max : longest)
+        for (int i = numDepots; i < matrixSize; i++)
+        {
+            const double x = xs[i];
+            const double y = ys[i];
+            double rowLongest = 0.0;
+#pragma omp simd reduction(max : rowLongest)
+            for (int j = 0; j < i; j++)
             {
-                double x_dist = allLocations[j].x - allLocations[i].x;
-                double y_dist = allLocations[j].y - allLocations[i].y;
-                distanceMatrix.rows[i][j] = std::sqrt((x_dist * x_dist) + (y_dist * y_dist));
+                const double x_dist = xs[j] - x;
+                const double y_dist = ys[j] - y;
+                rowLongest = std::max(rowLongest, (x_dist * x_dist) + (y_dist * y_dist));
             }
+            longest = std::max(longest, rowLongest);
         }
+        longest = std::sqrt(longest);
+        const double scale = longest > 0.0 ? longest / (UINT16_MAX - 1) : 1.0;
+        distanceMatrix.fixedScale = scale;
+
+        // Distances are not negative, so adding a half and truncating rounds to the nearest step. The division makes
+        // this the one storage where computing a single triangle pays off. Depot pairs are filled too before they are
+        // made infinite, and may be longer than longest, so the steps are capped to stay in range.
+        distanceMatrix.fixedData.resize(n * n);
+        fillSymmetric(xs, ys, numDepots, distanceMatrix.fixedData.data(), static_cast<std::uint16_t>(UINT16_MAX), [scale](const double value)
+                      { return static_cast<std::uint16_t>(std::min(value / scale + 0.5, static_cast<double>(UINT16_MAX - 1))); });
+        return distanceMatrix;
     }
 
+    distanceMatrix.data.resize(n * n);
+    distanceMatrix.rows = std::vector<double *>(matrixSize);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        distanceMatrix.rows[i] = &distanceMatrix.data[i * n];
+    }
+
+    // Fill the matrix with the distances between locations
+    fillSquare(xs, ys, numDepots, distanceMatrix.data.data(), infinity, [](const double value)
+                  { return value; });
+
+    return distanceMatrix;
+}
+
+// Out of line so operator() stays small, loops that read many distances use withDistances instead.
+double Matrix::computeDistance(const size_t i, const size_t j) const
+{
+    return withDistances(*this, [i, j](const auto &d)
+                         { return d(i, j); });
+}
+
+/* Distances from location i to the locations [first, last)
+    - Dense storage returns a pointer into the matrix and does not touch buffer.
+    - The other storages write them into buffer, which needs room for last - first values. Coordinates storage
+      computes them in one vectorised loop.
+*/
+const double *Matrix::row(const size_t i, const size_t first, const size_t last, double *buffer) const
+{
+    if (storage == MatrixStorage::Dense)
+    {
+        return rows[i] + first;
+    }
+    if (storage != MatrixStorage::Coordinates)
+    {
+        withDistances(*this, [&](const auto &d)
+                      {
+                          for (size_t j = first; j < last; ++j)
+                          {
+                              buffer[j - first] = d(i, j);
+                          } });
+        return buffer;
+    }
+
+    const double x = xs[i];
+    const double y = ys[i];
+    const double *xj = xs.data() + first;
+    const double *yj = ys.data() + first;
+    const size_t count = last - first;
+#pragma omp simd
+    for (size_t k = 0; k < count; ++k)
+    {
+        const double x_dist = xj[k] - x;
+        const double y_dist = yj[k] - y;
+        buffer[k] = std::sqrt((x_dist * x_dist) + (y_dist * y_dist));
+    }
+    if (i >= first && i < last)
+    {
+        buffer[i - first] = std::numeric_limits<double>::infinity();
+    }
+    return buffer;
+}
+
+// Wraps an existing size x size row-major matrix without copying it, e.g. one passed in from NumPy.
+// The distances must outlive the Matrix. locations stays empty, so neighbour lists are taken from the rows.
+Matrix getDistanceMatrixView(const double *distances, const size_t size)
+{
+    Matrix distanceMatrix;
+    distanceMatrix.rows = std::vector<double *>(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        distanceMatrix.rows[i] = const_cast<double *>(distances + i * size);
+    }
     return distanceMatrix;
 }
 
@@ -106,7 +348,8 @@ void exportMatrixToCSV(const std::vector<std::vector<int>> &routes, const std::v
     file.close();
 }
 
-void exportRoutesProgressToCSV(const std::vector<std::vector<std::vector<int>>> &routesProgress, const std::vector<Point> &locations, const std::string &filename)
+// Writes every frame of the progress, each followed by END. Frames are rebuilt one at a time while writing.
+void exportRoutesProgressToCSV(const RoutesProgress &routesProgress, const std::vector<Point> &locations, const std::string &filename)
 {
     std::ofstream file(filename);
 
@@ -119,9 +362,10 @@ void exportRoutesProgressToCSV(const std::vector<std::vector<std::vector<int>>>
     file << "\n";
 
     // Write the routes
-    for (const auto &routes : routesProgress)
+    ProgressCursor cursor(routesProgress);
+    while (cursor.next())
     {
-        for (const auto &route : routes)
+        for (const auto &route : cursor.routes())
         {
             for (const auto customer : route)
             {
@@ -0,0 +1,67 @@
+#include "genetic_algorithm.h"
+#include "utils.h"
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Counts every heap allocation made by the test binary
+static std::atomic<size_t> allocationCount{0};
+
+void *operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size == 0 ? 1 : size))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+static size_t allocationsOfRun(const Matrix &distanceMatrix, const size_t generations, const GeneticOptions &options)
+{
+    size_t before = allocationCount.load();
+    geneticSolver(distanceMatrix, 10, 30, generations, 0.5f, StartingType::Random, options);
+    return allocationCount.load() - before;
+}
+
+/* Checks that the generations of geneticSolver do not allocate once the populations and route pools are warm:
+   a run with 200 more generations makes (almost) no more allocations than a short one. Before the populations
+   were double buffered every generation allocated thousands of times.
+*/
+TEST_CASE("geneticSolver generations do not allocate in the steady state", "[geneticSolver]")
+{
+    std::vector<Point> depots = {{550.0, 550.0}};
+    std::vector<Point> customers = getRandomPoints(100, 100.0, 1000.0, 11);
+    Matrix distanceMatrix = getDistanceMatrix(depots, customers);
+
+    for (Representation representation : {Representation::Routes, Representation::GiantTour})
+    {
+        for (LocalSearchType localSearch : {LocalSearchType::TwoOptSwap, LocalSearchType::IntraRoute, LocalSearchType::IntraInterRoute})
+        {
+            GeneticOptions options;
+            options.localSearch = localSearch;
+            options.representation = representation;
+            options.recordHistory = false;
+            options.seed = 5;
+
+            // The first run warms up the per-thread route pools and buffers
+            allocationsOfRun(distanceMatrix, 50, options);
+            size_t shortRun = allocationsOfRun(distanceMatrix, 50, options);
+            size_t longRun = allocationsOfRun(distanceMatrix, 250, options);
+
+            INFO("50 generations: " << shortRun << " allocations, 250 generations: " << longRun);
+            REQUIRE(longRun <= shortRun + 20);
+        }
+    }
+}
@@ -0,0 +1,382 @@
+#include "api_solvers.h"
+#include "solve_job.h"
+#include "genetic_algorithm.h"
+#include "utils.h"
+#include "spatial_index.h"
+#include <catch2/catch_test_macros.hpp>
+#include <vector>
+#include <random>
+#include <stdexcept>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <numeric>
+
+static void randomCustomers(const size_t numCustomers, std::vector<double> &customers_x, std::vector<double> &customers_y)
+{
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> coordDist(100.0, 500.0);
+    for (size_t i = 0; i < numCustomers; ++i)
+    {
+        customers_x.push_back(coordDist(gen));
+        customers_y.push_back(coordDist(gen));
+    }
+}
+
+/* Checks that a genetic solve job:
+    1. Gives the same result as the blocking solver with the same seed when it runs to the end.
+    2. Reports its generation and best distance while running, and stops with StopReason::Cancelled when cancelled.
+    3. Rethrows the solver's exceptions from result().
+*/
+TEST_CASE("Solve jobs run, report progress and cancel", "[solveJob]")
+{
+    std::vector<double> customers_x;
+    std::vector<double> customers_y;
+    randomCustomers(60, customers_x, customers_y);
+
+    GeneticOptions options;
+    options.seed = 11;
+    options.recordHistory = false;
+
+    SECTION("Finished job matches completeSolverGenetic")
+    {
+        auto job = startSolverGenetic(300, 300, customers_x, customers_y, 8, 20, 15, 0.5f, false, StartingType::Random, "", options);
+        const GeneticResult &jobResult = job->result();
+        GeneticResult direct = completeSolverGenetic(300, 300, customers_x, customers_y, 8, 20, 15, 0.5f, false, StartingType::Random, "", options);
+
+        REQUIRE(job->done());
+        REQUIRE(jobResult.stopReason == StopReason::MaxGenerations);
+        REQUIRE(jobResult.generations == 15);
+        REQUIRE(job->generation() == 15);
+        REQUIRE(jobResult.progress.back() == direct.progress.back());
+    }
+
+    SECTION("Cancelled job stops early with its best routes")
+    {
+        const size_t maxGenerations = 1000000;
+        auto job = startSolverGenetic(300, 300, customers_x, customers_y, 8, 20, maxGenerations, 0.5f, false, StartingType::Random, "", options);
+        while (job->generation() < 3)
+        {
+            REQUIRE_FALSE(job->waitFor(0.001));
+        }
+        REQUIRE(job->bestDistance() < std::numeric_limits<double>::infinity());
+
+        job->cancel();
+        const GeneticResult &result = job->result();
+        REQUIRE(result.stopReason == StopReason::Cancelled);
+        REQUIRE(result.generations >= 3);
+        REQUIRE(result.generations < maxGenerations);
+        REQUIRE(result.progress.size() == 1);
+    }
+
+    SECTION("Errors are rethrown by result")
+    {
+        auto job = startSolverGenetic(300, 300, customers_x, customers_y, 1, 20, 15, 0.5f, false, StartingType::Random, "", options);
+        job->wait();
+        REQUIRE_THROWS_AS(job->result(), std::invalid_argument);
+    }
+
+    SECTION("Destroying a running job cancels it")
+    {
+        auto job = startSolverGenetic(300, 300, customers_x, customers_y, 8, 20, 1000000, 0.5f, false, StartingType::Random, "", options);
+        job.reset();
+        SUCCEED();
+    }
+}
+
+// The array entry points read coordinates in place and can take a precomputed matrix instead of building one.
+TEST_CASE("Solvers give the same routes from arrays and from a distance matrix view", "[api]")
+{
+    std::vector<double> customers_x;
+    std::vector<double> customers_y;
+    randomCustomers(80, customers_x, customers_y);
+
+    std::vector<Point> depots = {{300, 300}};
+    std::vector<Point> customers;
+    for (size_t i = 0; i < customers_x.size(); ++i)
+    {
+        customers.push_back({customers_x[i], customers_y[i]});
+    }
+    Matrix distMatrix = getDistanceMatrix(depots, customers);
+    const double *distances = distMatrix.data.data();
+
+    RoutesProgress fromVectors = completeSolverClarkeWright(300, 300, customers_x, customers_y, 10, false);
+    RoutesProgress fromView = completeSolverClarkeWright(300, 300, customers_x.data(), customers_y.data(), customers_x.size(), distances, 10, false);
+    REQUIRE(fromView.frames() == fromVectors.frames());
+
+    GeneticOptions options;
+    options.seed = 5;
+    GeneticResult geneticFromVectors = completeSolverGenetic(300, 300, customers_x, customers_y, 10, 20, 10, 0.5f, false, StartingType::Mixed, "", options);
+    GeneticResult geneticFromView = completeSolverGenetic(300, 300, customers_x.data(), customers_y.data(), customers_x.size(), distances,
+                                                          10, 20, 10, 0.5f, false, StartingType::Mixed, "", options);
+    REQUIRE(geneticFromView.progress.frames() == geneticFromVectors.progress.frames());
+
+    REQUIRE_THROWS_AS(startSolverGenetic(300, 300, customers_x, customers_y, 10, 20, 10, 0.5f, false, StartingType::Mixed, "", options, {1.0, 2.0}),
+                      std::invalid_argument);
+}
+
+// Batches run their instances in any order on any thread, the results must still match solving them one by one.
+TEST_CASE("Batch solvers give the same results as solving each instance", "[batch]")
+{
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<size_t> customerDist(5, 60);
+    std::uniform_int_distribution<size_t> maxPackagesDist(3, 12);
+
+    std::vector<BatchInstance> instances(40);
+    for (auto &instance : instances)
+    {
+        instance.depot_x = 300;
+        instance.depot_y = 300;
+        instance.maxPackages = maxPackagesDist(gen);
+        std::uniform_real_distribution<double> coordDist(100.0, 500.0);
+        for (size_t i = customerDist(gen); i > 0; --i)
+        {
+            instance.customers_x.push_back(coordDist(gen));
+            instance.customers_y.push_back(coordDist(gen));
+        }
+    }
+
+    GeneticOptions options;
+    options.seed = 9;
+    options.recordHistory = false;
+
+    // A large instance size of 30 puts about half of them in the serial part
+    for (size_t largeInstanceSize : {1000, 30})
+    {
+        BatchResult<RoutesProgress> clarkeWright = completeSolverClarkeWrightBatch(instances, 0, false, largeInstanceSize);
+        BatchResult<GeneticResult> genetic = completeSolverGeneticBatch(instances, 10, 5, 0.5f, StartingType::Mixed, options, largeInstanceSize);
+        REQUIRE(clarkeWright.results.size() == instances.size());
+        REQUIRE(genetic.results.size() == instances.size());
+        REQUIRE(clarkeWright.instancesPerSecond > 0.0);
+
+        for (size_t i = 0; i < instances.size(); ++i)
+        {
+            const BatchInstance &instance = instances[i];
+            RoutesProgress single = completeSolverClarkeWright(instance.depot_x, instance.depot_y, instance.customers_x, instance.customers_y,
+                                                               instance.maxPackages, false, "", 0, false);
+            REQUIRE(clarkeWright.results[i].back() == single.back());
+
+            GeneticResult singleGenetic = completeSolverGenetic(instance.depot_x, instance.depot_y, instance.customers_x, instance.customers_y,
+                                                                instance.maxPackages, 10, 5, 0.5f, false, StartingType::Mixed, "", options);
+            REQUIRE(genetic.results[i].progress.back() == singleGenetic.progress.back());
+        }
+    }
+
+    SolveMonitor monitor;
+    options.monitor = &monitor;
+    REQUIRE_THROWS_AS(completeSolverGeneticBatch(instances, 10, 5, 0.5f, StartingType::Mixed, options), std::invalid_argument);
+    options.monitor = nullptr;
+
+    instances[7].maxPackages = 1;
+    REQUIRE_THROWS_AS(completeSolverGeneticBatch(instances, 10, 5, 0.5f, StartingType::Mixed, options), std::invalid_argument);
+}
+
+// Coordinates and PackedTriangular storage hold the same distances as the dense matrix, so the solvers must give
+// identical routes. Float32 and FixedPoint are only as close as their precision.
+TEST_CASE("Every matrix storage matches the dense matrix", "[MatrixStorage]")
+{
+    std::vector<double> customers_x;
+    std::vector<double> customers_y;
+    randomCustomers(120, customers_x, customers_y);
+
+    std::vector<Point> depots = {{300, 300}};
+    std::vector<Point> customers;
+    for (size_t i = 0; i < customers_x.size(); ++i)
+    {
+        customers.push_back({customers_x[i], customers_y[i]});
+    }
+    Matrix dense = getDistanceMatrix(depots, customers);
+    Matrix coordinates = getDistanceMatrix(depots, customers, MatrixStorage::Coordinates);
+    REQUIRE(coordinates.size() == dense.size());
+    REQUIRE(coordinates.data.empty());
+
+    std::vector<double> buffer(dense.size());
+    for (size_t i = 0; i < dense.size(); ++i)
+    {
+        for (size_t first : {size_t(0), i, i + 1})
+        {
+            const double *row = coordinates.row(i, first, dense.size(), buffer.data());
+            for (size_t j = first; j < dense.size(); ++j)
+            {
+                REQUIRE(coordinates(i, j) == dense(i, j));
+                REQUIRE(row[j - first] == dense(i, j));
+            }
+        }
+    }
+    REQUIRE_THROWS_AS(getDistanceMatrix({{0, 0}, {1, 1}}, customers, MatrixStorage::Coordinates), std::invalid_argument);
+
+    // The compact storages give the same distances, up to their precision
+    for (MatrixStorage storage : {MatrixStorage::PackedTriangular, MatrixStorage::Float32, MatrixStorage::FixedPoint})
+    {
+        Matrix compact = getDistanceMatrix(depots, customers, storage);
+        REQUIRE(compact.size() == dense.size());
+        for (size_t i = 0; i < dense.size(); ++i)
+        {
+            const double *row = compact.row(i, 0, dense.size(), buffer.data());
+            for (size_t j = 0; j < dense.size(); ++j)
+            {
+                const double tolerance = storage == MatrixStorage::PackedTriangular ? 0.0 : storage == MatrixStorage::Float32 ? dense(i, j) * 1e-7 : compact.fixedScale / 2;
+                REQUIRE(row[j] == compact(i, j));
+                if (i == j)
+                {
+                    REQUIRE(compact(i, j) == std::numeric_limits<double>::infinity());
+                }
+                else
+                {
+                    REQUIRE(std::abs(compact(i, j) - dense(i, j)) <= tolerance + 1e-12);
+                }
+            }
+        }
+    }
+
+    // Exact storages must give the same routes as the dense matrix
+    for (MatrixStorage storage : {MatrixStorage::Coordinates, MatrixStorage::PackedTriangular})
+    {
+        for (size_t numNeighbours : {0, 10})
+        {
+            RoutesProgress fromDense = completeSolverClarkeWright(300, 300, customers_x.data(), customers_y.data(), customers_x.size(), nullptr,
+                                                                  10, false, "", numNeighbours, true, MatrixStorage::Dense);
+            RoutesProgress fromStorage = completeSolverClarkeWright(300, 300, customers_x.data(), customers_y.data(), customers_x.size(), nullptr,
+                                                                    10, false, "", numNeighbours, true, storage);
+            REQUIRE(fromStorage.frames() == fromDense.frames());
+        }
+
+        GeneticOptions options;
+        options.seed = 2;
+        options.localSearch = LocalSearchType::IntraInterRoute;
+        GeneticResult geneticFromDense = completeSolverGenetic(300, 300, customers_x.data(), customers_y.data(), customers_x.size(), nullptr,
+                                                               10, 20, 10, 0.5f, false, StartingType::Mixed, "", options, MatrixStorage::Dense);
+        GeneticResult geneticFromStorage = completeSolverGenetic(300, 300, customers_x.data(), customers_y.data(), customers_x.size(), nullptr,
+                                                                 10, 20, 10, 0.5f, false, StartingType::Mixed, "", options, storage);
+        REQUIRE(geneticFromStorage.progress.frames() == geneticFromDense.progress.frames());
+    }
+}
+
+// The builders compute the matrix in tiles and set the invalid paths afterwards, so check an instance with several
+// depots whose size is not a multiple of the tile against the distances computed one by one. The last two depots are
+// further apart than any depot and customer, which FixedPoint leaves out of its longest distance.
+TEST_CASE("getDistanceMatrix gives every distance with several depots", "[MatrixStorage]")
+{
+    std::vector<double> customers_x;
+    std::vector<double> customers_y;
+    randomCustomers(150, customers_x, customers_y);
+
+    std::vector<Point> depots = {{300, 300}, {120, 450}, {480, 110}, {-4000, 300}, {4000, 300}};
+    std::vector<Point> locations = depots;
+    std::vector<Point> customers;
+    for (size_t i = 0; i < customers_x.size(); ++i)
+    {
+        customers.push_back({customers_x[i], customers_y[i]});
+        locations.push_back(customers.back());
+    }
+
+    for (MatrixStorage storage : {MatrixStorage::Dense, MatrixStorage::PackedTriangular, MatrixStorage::Float32, MatrixStorage::FixedPoint})
+    {
+        Matrix distMatrix = getDistanceMatrix(depots, customers, storage);
+        REQUIRE(distMatrix.size() == locations.size());
+        for (size_t i = 0; i < locations.size(); ++i)
+        {
+            for (size_t j = 0; j < locations.size(); ++j)
+            {
+                if (i == j || (i < depots.size() && j < depots.size()))
+                {
+                    REQUIRE(distMatrix(i, j) == std::numeric_limits<double>::infinity());
+                    continue;
+                }
+                double x_dist = locations[j].x - locations[i].x;
+                double y_dist = locations[j].y - locations[i].y;
+                double expected = std::sqrt((x_dist * x_dist) + (y_dist * y_dist));
+                const double tolerance = storage == MatrixStorage::Float32 ? expected * 1e-7 : storage == MatrixStorage::FixedPoint ? distMatrix.fixedScale / 2 : 0.0;
+                REQUIRE(std::abs(distMatrix(i, j) - expected) <= tolerance + 1e-12);
+                REQUIRE(distMatrix(i, j) == distMatrix(j, i));
+            }
+        }
+    }
+}
+
+/* Checks the routes of solves with reorder:
+    1. Customers given along the curve already are not renumbered, so reorder changes nothing.
+    2. The same customers shuffled and reordered give the same routes under the shuffled numbers, also with a
+       distance matrix.
+*/
+TEST_CASE("Solvers with reorder give routes in the caller's numbering", "[reorder]")
+{
+    std::vector<double> customers_x;
+    std::vector<double> customers_y;
+    randomCustomers(90, customers_x, customers_y);
+
+    std::vector<Point> customers;
+    for (size_t i = 0; i < customers_x.size(); ++i)
+    {
+        customers.push_back({customers_x[i], customers_y[i]});
+    }
+    std::vector<int> curve = hilbertOrder(customers);
+    std::vector<double> sorted_x;
+    std::vector<double> sorted_y;
+    for (int customer : curve)
+    {
+        sorted_x.push_back(customers_x[customer]);
+        sorted_y.push_back(customers_y[customer]);
+    }
+
+    // shuffled customer position[c] is sorted customer c
+    std::vector<int> position(sorted_x.size());
+    std::iota(position.begin(), position.end(), 0);
+    std::mt19937 gen(5);
+    std::shuffle(position.begin(), position.end(), gen);
+    std::vector<double> shuffled_x(sorted_x.size());
+    std::vector<double> shuffled_y(sorted_y.size());
+    for (size_t c = 0; c < position.size(); ++c)
+    {
+        shuffled_x[position[c]] = sorted_x[c];
+        shuffled_y[position[c]] = sorted_y[c];
+    }
+    auto toShuffled = [&](std::vector<std::vector<std::vector<int>>> frames)
+    {
+        for (auto &frame : frames)
+        {
+            for (auto &route : frame)
+            {
+                for (int &customer : route)
+                {
+                    customer = customer == 0 ? 0 : position[customer - 1] + 1;
+                }
+            }
+        }
+        return frames;
+    };
+
+    std::vector<Point> shuffledCustomers;
+    for (size_t c = 0; c < shuffled_x.size(); ++c)
+    {
+        shuffledCustomers.push_back({shuffled_x[c], shuffled_y[c]});
+    }
+    Matrix shuffledMatrix = getDistanceMatrix({{300, 300}}, shuffledCustomers);
+    std::vector<double> distances;
+    for (size_t i = 0; i < shuffledMatrix.size(); ++i)
+    {
+        for (size_t j = 0; j < shuffledMatrix.size(); ++j)
+        {
+            distances.push_back(shuffledMatrix(i, j));
+        }
+    }
+
+    RoutesProgress plain = completeSolverClarkeWright(300, 300, sorted_x.data(), sorted_y.data(), sorted_x.size(), nullptr, 10, false, "", 0, true);
+    RoutesProgress sortedReordered = completeSolverClarkeWright(300, 300, sorted_x.data(), sorted_y.data(), sorted_x.size(), nullptr, 10, false, "", 0, true,
+                                                                MatrixStorage::Dense, true);
+    RoutesProgress shuffledReordered = completeSolverClarkeWright(300, 300, shuffled_x.data(), shuffled_y.data(), shuffled_x.size(), nullptr, 10, false, "", 0, true,
+                                                                  MatrixStorage::Dense, true);
+    RoutesProgress matrixReordered = completeSolverClarkeWright(300, 300, shuffled_x.data(), shuffled_y.data(), shuffled_x.size(), distances.data(), 10, false, "", 0, true,
+                                                                MatrixStorage::Dense, true);
+    REQUIRE(sortedReordered.frames() == plain.frames());
+    REQUIRE(shuffledReordered.frames() == toShuffled(plain.frames()));
+    REQUIRE(matrixReordered.frames() == toShuffled(plain.frames()));
+
+    GeneticOptions options;
+    options.seed = 4;
+    GeneticResult geneticPlain = completeSolverGenetic(300, 300, sorted_x.data(), sorted_y.data(), sorted_x.size(), nullptr,
+                                                       10, 20, 10, 0.5f, false, StartingType::Mixed, "", options);
+    GeneticResult geneticReordered = completeSolverGenetic(300, 300, shuffled_x.data(), shuffled_y.data(), shuffled_x.size(), nullptr,
+                                                           10, 20, 10, 0.5f, false, StartingType::Mixed, "", options, MatrixStorage::Dense, true);
+    REQUIRE(geneticReordered.progress.frames() == toShuffled(geneticPlain.progress.frames()));
+}
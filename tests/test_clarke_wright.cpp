@@ -3,12 +3,15 @@
 #include <catch2/catch_test_macros.hpp>
 #include <random>
 #include <sstream>
+#include <algorithm>
 
 /* Fuzz test checks that:
     1. The routes generated include every customer (represented as their index) exactly once.
     2. Each route starts and ends with zero (depot).
     3. Zero does not occur anywhere else.
     4. No route is longer than the max length (maxPackages).
+    5. The last frame of the recorded progress is the returned solution.
+   Both with the full savings list and with granular neighbour lists (numNeighbours > 0).
 */
 TEST_CASE("Fuzz test that clarkeWrightSolver returns a proper solution", "[clarkeWrightSolver]")
 {
@@ -24,21 +27,26 @@ TEST_CASE("Fuzz test that clarkeWrightSolver returns a proper solution", "[clark
     size_t minMaxPackages = 5;
     size_t maxMaxPackages = 15;
 
+    size_t maxNeighbours = 20;
+
     static std::random_device rd;
     static std::mt19937 gen(rd());
     std::uniform_int_distribution<size_t> customerDist(minCustomers, maxCustomers);
     std::uniform_int_distribution<size_t> maxPackagesDist(minMaxPackages, maxMaxPackages);
+    std::uniform_int_distribution<size_t> neighboursDist(0, maxNeighbours);
 
     for (size_t i = 0; i < fuzzRounds; ++i)
     {
         const size_t numCustomers = customerDist(gen);
         const size_t maxPackages = maxPackagesDist(gen);
+        const size_t numNeighbours = neighboursDist(gen);
 
         std::vector<Point> depots = getRandomPoints(numDepots, minDistance, maxDistance);
         std::vector<Point> customers = getRandomPoints(numCustomers, minDistance, maxDistance);
         Matrix distanceMatrix = getDistanceMatrix(depots, customers);
 
-        auto [routes, routesProgress] = clarkeWrightSolver(distanceMatrix, maxPackages);
+        auto [routes, routesProgress] = clarkeWrightSolver(distanceMatrix, maxPackages, numNeighbours);
+        REQUIRE(routesProgress.back() == routes);
 
         // Count occurences of each index
         std::vector<int> count(numCustomers + 1, 0);
@@ -59,6 +67,8 @@ TEST_CASE("Fuzz test that clarkeWrightSolver returns a proper solution", "[clark
                 std::ostringstream oss;
                 oss << "numCustomers: " << numCustomers;
                 oss << "\n";
+                oss << "numNeighbours: " << numNeighbours;
+                oss << "\n";
                 oss << "count[" << i << "] is " << count[i];
                 oss << "\n";
                 for (const auto &route : routes)
@@ -141,6 +151,35 @@ TEST_CASE("Process savings joins routes", "[processSavings]")
     REQUIRE(actualRoutes == expectedRoutes);
 }
 
+TEST_CASE("Process savings records the routes after every step", "[processSavings]")
+{
+    std::vector<std::tuple<int, int, double>> savings = {
+        {1, 2, 10.0},
+        {3, 4, 9.0},
+        {2, 3, 8.0}};
+    int numCustomers = 5;
+    int maxPackages = 100;
+
+    auto [actualRoutes, routesProgress] = processSavings(savings, numCustomers, maxPackages);
+
+    std::vector<std::vector<std::vector<int>>> expectedProgress = {
+        {{0, 1, 2, 0}},
+        {{0, 1, 2, 0}, {0, 3, 4, 0}},
+        {{0, 1, 2, 3, 4, 0}},
+        {{0, 1, 2, 3, 4, 0}, {0, 5, 0}}};
+
+    REQUIRE(routesProgress.frames() == expectedProgress);
+    REQUIRE(actualRoutes == expectedProgress.back());
+    for (size_t i = 0; i < expectedProgress.size(); ++i)
+    {
+        REQUIRE(routesProgress.frame(i) == expectedProgress[i]);
+    }
+
+    auto [finalRoutes, finalProgress] = processSavings(savings, numCustomers, maxPackages, false);
+    REQUIRE(finalRoutes == actualRoutes);
+    REQUIRE(finalProgress.frames() == std::vector<std::vector<std::vector<int>>>{actualRoutes});
+}
+
 TEST_CASE("Process savings adds elements to two routes and then joins them", "[processSavings]")
 {
     std::vector<std::tuple<int, int, double>> savings = {
@@ -279,4 +318,44 @@ TEST_CASE("Example savings list from 15 random points is processsed correctly",
     };
 
     REQUIRE(actualRoutes == expectedRoutes);
-}
\ No newline at end of file
+}
+
+/* Fuzz test checks that sortSavings:
+    1. Orders the savings from largest to smallest, negative savings and repeated values included.
+    2. Keeps equal savings in their original order (the same result as std::stable_sort).
+*/
+TEST_CASE("Fuzz test that sortSavings sorts like a stable sort", "[sortSavings]")
+{
+    size_t fuzzRounds = 100;
+
+    static std::random_device rd;
+    static std::mt19937 gen(rd());
+    std::uniform_int_distribution<size_t> sizeDist(0, 5000);
+    std::uniform_int_distribution<int> valueDist(-50, 50);
+    std::uniform_real_distribution<float> fractionDist(-1000.0f, 1000.0f);
+
+    for (size_t round = 0; round < fuzzRounds; ++round)
+    {
+        const size_t size = sizeDist(gen);
+        const bool fewValues = round % 2 == 0;
+
+        std::vector<Saving> savings(size);
+        for (size_t k = 0; k < size; ++k)
+        {
+            float saving = fewValues ? static_cast<float>(valueDist(gen)) : fractionDist(gen);
+            savings[k] = {saving, static_cast<std::uint32_t>(k), static_cast<std::uint32_t>(k + 1)};
+        }
+
+        std::vector<Saving> expected = savings;
+        std::stable_sort(expected.begin(), expected.end(), [](const Saving &a, const Saving &b)
+                         { return a.saving > b.saving; });
+        sortSavings(savings);
+
+        REQUIRE(savings.size() == expected.size());
+        for (size_t k = 0; k < size; ++k)
+        {
+            REQUIRE(savings[k].saving == expected[k].saving);
+            REQUIRE(savings[k].i == expected[k].i);
+        }
+    }
+}
@@ -0,0 +1,156 @@
+#include "decomposition.h"
+#include "clarke_wright.h"
+#include "genetic_algo_utils.h"
+#include "utils.h"
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <omp.h>
+
+static std::vector<Point> randomLocations(const size_t numCustomers, const unsigned int seed)
+{
+    std::vector<Point> locations = {{300.0, 300.0}};
+    std::vector<Point> customers = getRandomPoints(numCustomers, 100.0, 500.0, seed);
+    locations.insert(locations.end(), customers.begin(), customers.end());
+    return locations;
+}
+
+/* Fuzz test checks that:
+    1. The routes generated include every customer exactly once.
+    2. Each route starts and ends with the depot and no route is longer than maxPackages.
+    3. Every round of windows keeps or shortens the total distance.
+*/
+TEST_CASE("Fuzz test that decompositionSolver returns a proper solution", "[decompositionSolver]")
+{
+    static std::random_device rd;
+    static std::mt19937 gen(rd());
+    std::uniform_int_distribution<size_t> customerDist(1, 400);
+    std::uniform_int_distribution<size_t> maxPackagesDist(2, 15);
+    std::uniform_int_distribution<size_t> partitionDist(1, 150);
+    std::uniform_int_distribution<size_t> windowDist(0, 10);
+    std::uniform_int_distribution<size_t> passesDist(0, 2);
+
+    for (size_t round = 0; round < 40; ++round)
+    {
+        const size_t numCustomers = customerDist(gen);
+        const size_t maxPackages = maxPackagesDist(gen);
+        std::vector<Point> locations = randomLocations(numCustomers, gen());
+        Matrix distanceMatrix = getDistanceMatrix({locations[0]}, std::vector<Point>(locations.begin() + 1, locations.end()), MatrixStorage::Coordinates);
+
+        DecompositionOptions options;
+        options.partitionSize = partitionDist(gen);
+        options.windowRoutes = windowDist(gen);
+        options.windowPasses = passesDist(gen);
+        options.numNeighbours = gen() % 2 == 0 ? 0 : 8;
+        if (round % 4 == 0)
+        {
+            options.subSolver = SubSolver::Genetic;
+            options.populationSize = 6;
+            options.generations = 5;
+            options.genetic.seed = gen();
+        }
+
+        auto [routes, progress] = decompositionSolver(distanceMatrix, locations, maxPackages, options);
+        REQUIRE(progress.back() == routes);
+
+        std::vector<int> count(numCustomers + 1, 0);
+        for (const auto &route : routes)
+        {
+            REQUIRE(route.size() >= 3);
+            REQUIRE(route.size() <= maxPackages + 2);
+            REQUIRE(route.front() == 0);
+            REQUIRE(route.back() == 0);
+            for (size_t k = 1; k + 1 < route.size(); ++k)
+            {
+                REQUIRE(route[k] > 0);
+                REQUIRE(route[k] <= static_cast<int>(numCustomers));
+                count[route[k]]++;
+            }
+        }
+        for (size_t i = 1; i <= numCustomers; ++i)
+        {
+            REQUIRE(count[i] == 1);
+        }
+
+        const auto frames = progress.frames();
+        for (size_t f = 1; f < frames.size(); ++f)
+        {
+            REQUIRE(distanceOfRoutes(frames[f], distanceMatrix) < distanceOfRoutes(frames[f - 1], distanceMatrix));
+        }
+    }
+}
+
+TEST_CASE("sweepSectors splits the customers into sectors of nearly equal size", "[sweepSectors]")
+{
+    std::vector<Point> locations = randomLocations(103, 4);
+    std::vector<std::vector<int>> sectors = sweepSectors(locations, 25);
+    REQUIRE(sectors.size() == 5);
+
+    std::vector<int> seen;
+    for (const auto &sector : sectors)
+    {
+        REQUIRE(sector.size() >= 20);
+        REQUIRE(sector.size() <= 21);
+        seen.insert(seen.end(), sector.begin(), sector.end());
+    }
+    std::sort(seen.begin(), seen.end());
+    for (size_t i = 0; i < seen.size(); ++i)
+    {
+        REQUIRE(seen[i] == static_cast<int>(i) + 1);
+    }
+
+    REQUIRE(sweepSectors({{0.0, 0.0}}, 10).empty());
+    REQUIRE_THROWS_AS(sweepSectors(locations, 0), std::invalid_argument);
+}
+
+TEST_CASE("decompositionSolver with one sector and no windows is clarkeWrightSolver", "[decompositionSolver]")
+{
+    std::vector<Point> locations = randomLocations(150, 5);
+    Matrix distanceMatrix = getDistanceMatrix({locations[0]}, std::vector<Point>(locations.begin() + 1, locations.end()));
+
+    DecompositionOptions options;
+    options.partitionSize = 150;
+    options.windowRoutes = 0;
+    // The sector numbers its customers in sweep order, so ties between savings can turn a route around
+    auto sameDirection = [](std::vector<std::vector<int>> routes)
+    {
+        for (auto &route : routes)
+        {
+            if (route[1] > route[route.size() - 2])
+            {
+                std::reverse(route.begin(), route.end());
+            }
+        }
+        return routes;
+    };
+    auto [routes, progress] = decompositionSolver(distanceMatrix, locations, 10, options);
+    REQUIRE(sameDirection(routes) == sameDirection(clarkeWrightSolver(distanceMatrix, 10).first));
+
+    REQUIRE_THROWS_AS(decompositionSolver(distanceMatrix, std::vector<Point>(locations.begin(), locations.end() - 1), 10, options), std::invalid_argument);
+}
+
+TEST_CASE("decompositionSolver gives the same routes for a seed whatever the number of threads", "[decompositionSolver]")
+{
+    std::vector<Point> locations = randomLocations(240, 6);
+    Matrix distanceMatrix = getDistanceMatrix({locations[0]}, std::vector<Point>(locations.begin() + 1, locations.end()));
+
+    DecompositionOptions options;
+    options.partitionSize = 60;
+    options.windowRoutes = 4;
+    options.subSolver = SubSolver::Genetic;
+    options.populationSize = 8;
+    options.generations = 10;
+    options.genetic.seed = 11;
+
+    const int threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+    auto [serialRoutes, serialProgress] = decompositionSolver(distanceMatrix, locations, 8, options);
+    omp_set_num_threads(4);
+    auto [parallelRoutes, parallelProgress] = decompositionSolver(distanceMatrix, locations, 8, options);
+    omp_set_num_threads(threads);
+
+    REQUIRE(parallelRoutes == serialRoutes);
+    REQUIRE(parallelProgress.frames() == serialProgress.frames());
+}
@@ -1,8 +1,13 @@
 #include "genetic_algorithm.h"
+#include "genetic_algo_utils.h"
+#include "create_child.h"
+#include "epoch_marks.h"
 #include "utils.h"
 #include <catch2/catch_test_macros.hpp>
 #include <random>
 #include <sstream>
+#include <omp.h>
+#include <chrono>
 
 /* Fuzz test checks that:
     1. The routes generated include every customer (represented as their index) exactly once.
@@ -38,6 +43,7 @@ TEST_CASE("Fuzz test that geneticSolver returns a proper solution", "[geneticSol
     std::uniform_int_distribution<size_t> generationsDist(minGenerations, maxGenerations);
     std::uniform_real_distribution<float> mutationDist(0.0f, 1.0f);
     std::uniform_int_distribution<int> startingTypeDist(0, static_cast<int>(StartingType::COUNT) - 1);
+    std::uniform_int_distribution<int> localSearchDist(0, static_cast<int>(LocalSearchType::COUNT) - 1);
 
     for (size_t i = 0; i < fuzzRounds; ++i)
     {
@@ -47,13 +53,16 @@ TEST_CASE("Fuzz test that geneticSolver returns a proper solution", "[geneticSol
         const size_t generations = generationsDist(gen);
         const float mutationProb = mutationDist(gen);
         StartingType randomType = static_cast<StartingType>(startingTypeDist(gen));
+        GeneticOptions options;
+        options.localSearch = static_cast<LocalSearchType>(localSearchDist(gen));
+        options.seed = gen();
 
         std::vector<Point> depots = getRandomPoints(numDepots, minDistance, maxDistance);
         std::vector<Point> customers = getRandomPoints(numCustomers, minDistance, maxDistance);
         Matrix distanceMatrix = getDistanceMatrix(depots, customers);
 
-        std::vector<std::vector<std::vector<int>>> genRoutesProgress = geneticSolver(
-            distanceMatrix, maxPackages, populationSize, generations, mutationProb, randomType);
+        RoutesProgress genRoutesProgress = geneticSolver(
+            distanceMatrix, maxPackages, populationSize, generations, mutationProb, randomType, options).progress;
 
         std::vector<std::vector<int>> finalRoutes = genRoutesProgress.back();
 
@@ -180,4 +189,281 @@ TEST_CASE("geneticSolver throws if distance matrix is empty", "[geneticSolver]")
 
     REQUIRE_THROWS(geneticSolver(
         distanceMatrix, maxPackages, populationSize, generations, mutationProb, startingType));
-}
\ No newline at end of file
+}
+
+TEST_CASE("geneticSolver gives the same routes for a seed whatever the number of threads", "[geneticSolver]")
+{
+    std::vector<Point> depots = {{550.0, 550.0}};
+    std::vector<Point> customers = getRandomPoints(60, 100.0, 1000.0, 7);
+    Matrix distanceMatrix = getDistanceMatrix(depots, customers);
+
+    GeneticOptions options;
+    options.seed = 42;
+    const int defaultThreads = omp_get_max_threads();
+
+    omp_set_num_threads(1);
+    RoutesProgress oneThread = geneticSolver(distanceMatrix, 8, 20, 30, 0.5f, StartingType::Mixed, options).progress;
+    omp_set_num_threads(4);
+    RoutesProgress fourThreads = geneticSolver(distanceMatrix, 8, 20, 30, 0.5f, StartingType::Mixed, options).progress;
+    omp_set_num_threads(defaultThreads);
+
+    REQUIRE(oneThread.frames() == fourThreads.frames());
+
+    options.seed = 43;
+    RoutesProgress otherSeed = geneticSolver(distanceMatrix, 8, 20, 30, 0.5f, StartingType::Random, options).progress;
+    options.seed = 42;
+    RoutesProgress sameSeed = geneticSolver(distanceMatrix, 8, 20, 30, 0.5f, StartingType::Random, options).progress;
+    REQUIRE(otherSeed.frames() != sameSeed.frames());
+}
+
+/* Checks the island model with both topologies:
+    1. Every customer is in the final routes exactly once and no route is longer than maxPackages.
+    2. The routes for a seed do not depend on the number of threads.
+*/
+TEST_CASE("geneticSolver with islands returns a proper solution", "[geneticSolver]")
+{
+    const size_t numCustomers = 80;
+    const size_t maxPackages = 8;
+    std::vector<Point> depots = {{550.0, 550.0}};
+    std::vector<Point> customers = getRandomPoints(numCustomers, 100.0, 1000.0, 3);
+    Matrix distanceMatrix = getDistanceMatrix(depots, customers);
+
+    for (MigrationTopology topology : {MigrationTopology::Ring, MigrationTopology::Random})
+    {
+        GeneticOptions options;
+        options.seed = 9;
+        options.islands.count = 4;
+        options.islands.migrationInterval = 5;
+        options.islands.migrants = 2;
+        options.islands.topology = topology;
+        const int defaultThreads = omp_get_max_threads();
+
+        omp_set_num_threads(1);
+        RoutesProgress oneThread = geneticSolver(distanceMatrix, maxPackages, 12, 23, 0.5f, StartingType::Mixed, options).progress;
+        omp_set_num_threads(3);
+        RoutesProgress threeThreads = geneticSolver(distanceMatrix, maxPackages, 12, 23, 0.5f, StartingType::Mixed, options).progress;
+        omp_set_num_threads(defaultThreads);
+
+        REQUIRE(oneThread.frames() == threeThreads.frames());
+
+        std::vector<int> count(numCustomers + 1, 0);
+        for (const auto &route : oneThread.back())
+        {
+            REQUIRE(route.front() == 0);
+            REQUIRE(route.back() == 0);
+            REQUIRE(route.size() <= maxPackages + 2);
+            for (size_t pos = 1; pos < route.size() - 1; ++pos)
+            {
+                count[route[pos]]++;
+            }
+        }
+        for (size_t customer = 1; customer <= numCustomers; ++customer)
+        {
+            REQUIRE(count[customer] == 1);
+        }
+    }
+}
+
+TEST_CASE("geneticSolver throws if islands exchange their whole population", "[geneticSolver]")
+{
+    std::vector<Point> depots = {{550.0, 550.0}};
+    std::vector<Point> customers = getRandomPoints(10, 100.0, 1000.0, 3);
+    Matrix distanceMatrix = getDistanceMatrix(depots, customers);
+
+    GeneticOptions options;
+    options.islands.count = 2;
+    options.islands.migrants = 10;
+    REQUIRE_THROWS(geneticSolver(distanceMatrix, 5, 10, 10, 0.5f, StartingType::ClarkeWright, options));
+
+    options.islands.migrants = 2;
+    options.islands.migrationInterval = 0;
+    REQUIRE_THROWS(geneticSolver(distanceMatrix, 5, 10, 10, 0.5f, StartingType::ClarkeWright, options));
+}
+
+TEST_CASE("geneticSolver stops early and says why", "[geneticSolver]")
+{
+    std::vector<Point> depots = {{550.0, 550.0}};
+    std::vector<Point> customers = getRandomPoints(60, 100.0, 1000.0, 5);
+    Matrix distanceMatrix = getDistanceMatrix(depots, customers);
+    const size_t manyGenerations = 1000000;
+
+    GeneticOptions options;
+    GeneticResult result = geneticSolver(distanceMatrix, 8, 10, 12, 0.5f, StartingType::Random, options);
+    REQUIRE(result.stopReason == StopReason::MaxGenerations);
+    REQUIRE(result.generations == 12);
+
+    options.targetDistance = 1e12;
+    result = geneticSolver(distanceMatrix, 8, 10, manyGenerations, 0.5f, StartingType::Random, options);
+    REQUIRE(result.stopReason == StopReason::TargetReached);
+    REQUIRE(result.generations == 0);
+
+    options.targetDistance = 0.0;
+    options.stallGenerations = 5;
+    result = geneticSolver(distanceMatrix, 8, 10, manyGenerations, 0.5f, StartingType::Random, options);
+    REQUIRE(result.stopReason == StopReason::Stalled);
+    REQUIRE(result.generations < manyGenerations);
+
+    options.stallGenerations = 0;
+    options.timeLimit = 0.2;
+    for (size_t islands : {1, 3})
+    {
+        options.islands.count = islands;
+        auto start = std::chrono::steady_clock::now();
+        result = geneticSolver(distanceMatrix, 8, 10, manyGenerations, 0.5f, StartingType::Random, options);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        REQUIRE(result.stopReason == StopReason::TimeLimit);
+        REQUIRE(result.generations < manyGenerations);
+        REQUIRE(seconds < 5.0);
+    }
+}
+
+// The lengths kept by the operators must be exactly what measuring the routes again gives, otherwise the fitness of a
+// child would drift from its routes over the generations.
+TEST_CASE("createChild keeps the lengths of the child's routes", "[createChild]")
+{
+    const size_t maxPackages = 7;
+    Matrix distanceMatrix = getDistanceMatrix({{550.0, 550.0}}, getRandomPoints(70, 100.0, 1000.0, 17));
+    std::vector<Individual> population = getRandomPopulation(distanceMatrix, 6, maxPackages, 3);
+    population.push_back(createCalrkeWrightIndividual(distanceMatrix, maxPackages));
+
+    Rng rng(5);
+    Individual child;
+    for (int round = 0; round < 300; ++round)
+    {
+        const Individual &first = population[rng.uniformInt(population.size())];
+        const Individual &second = population[rng.uniformInt(population.size())];
+        const LocalSearchType localSearch = static_cast<LocalSearchType>(round % static_cast<int>(LocalSearchType::COUNT));
+        createChild(first, second, child, maxPackages, 1.0f, distanceMatrix, rng, localSearch);
+
+        REQUIRE(child.lengths.size() == child.routes.size());
+        for (size_t r = 0; r < child.routes.size(); ++r)
+        {
+            REQUIRE(child.lengths[r] == routeDistance(child.routes[r], distanceMatrix));
+        }
+        REQUIRE(child.total_distance == distanceOfRoutes(child.routes, distanceMatrix));
+        population[rng.uniformInt(population.size())] = child;
+    }
+}
+
+/* Fuzz test checks that routeCrossover:
+    1. Puts every customer in the child exactly once, in routes of at most maxPackages customers.
+    2. Leaves no two routes that fit together and would save distance when joined in either order.
+*/
+TEST_CASE("Fuzz test that routeCrossover merges every route pair that saves distance", "[routeCrossover]")
+{
+    static std::random_device rd;
+    static std::mt19937 gen(rd());
+    std::uniform_int_distribution<size_t> customerDist(2, 300);
+    std::uniform_int_distribution<size_t> maxPackagesDist(3, 20);
+
+    Individual child;
+    for (int round = 0; round < 60; ++round)
+    {
+        const size_t numCustomers = customerDist(gen);
+        const size_t maxPackages = maxPackagesDist(gen);
+        Matrix distanceMatrix = getDistanceMatrix({{550.0, 550.0}}, getRandomPoints(numCustomers, 100.0, 1000.0, gen()));
+        std::vector<Individual> parents = getRandomPopulation(distanceMatrix, 2, maxPackages, gen());
+        routeCrossover(parents[0], parents[1], maxPackages, distanceMatrix, child);
+
+        std::vector<int> count(numCustomers + 1, 0);
+        for (const auto &route : child.routes)
+        {
+            REQUIRE(route.size() >= 3);
+            REQUIRE(route.size() <= maxPackages + 2);
+            REQUIRE(route.front() == 0);
+            REQUIRE(route.back() == 0);
+            for (size_t pos = 1; pos + 1 < route.size(); ++pos)
+            {
+                count[route[pos]]++;
+            }
+        }
+        for (size_t customer = 1; customer <= numCustomers; ++customer)
+        {
+            REQUIRE(count[customer] == 1);
+        }
+
+        const auto &routes = child.routes;
+        for (size_t i = 0; i < routes.size(); ++i)
+        {
+            for (size_t j = 0; j < routes.size(); ++j)
+            {
+                if (i == j || routes[i].size() + routes[j].size() > maxPackages + 2)
+                {
+                    continue;
+                }
+                const int last = routes[i][routes[i].size() - 2];
+                const int next = routes[j][1];
+                REQUIRE(distanceMatrix(last, 0) + distanceMatrix(0, next) - distanceMatrix(last, next) <= 0.0);
+            }
+        }
+    }
+}
+
+TEST_CASE("EpochMarks forgets every mark when cleared", "[EpochMarks]")
+{
+    EpochMarks marks;
+    marks.clear(10);
+    for (size_t id = 0; id < 10; id += 3)
+    {
+        marks.mark(id);
+    }
+    for (size_t id = 0; id < 10; ++id)
+    {
+        REQUIRE(marks.marked(id) == (id % 3 == 0));
+    }
+
+    // Growing keeps the new ids unmarked too
+    marks.clear(25);
+    marks.mark(20);
+    for (size_t id = 0; id < 25; ++id)
+    {
+        REQUIRE(marks.marked(id) == (id == 20));
+    }
+}
+
+/* Checks that createNearestNeighbourIndividual gives the routes of a plain scan of the matrix for every storage:
+   the nearest customer left, ties to the lowest id, until a route holds maxPackages / 2 customers.
+   With Float32 and FixedPoint the nearest customer by rounded distance is not always the nearest by location.
+*/
+TEST_CASE("createNearestNeighbourIndividual gives the routes of a scan for every storage", "[createNearestNeighbourIndividual]")
+{
+    const size_t maxPackages = 10;
+    std::vector<Point> depots = {{550.0, 550.0}};
+    std::vector<Point> customers = getRandomPoints(400, 100.0, 1000.0, 9);
+    customers[30] = customers[60];
+    // A far customer makes the steps of FixedPoint coarse, so many distances round to the same value
+    customers.push_back({200000.0, 200000.0});
+
+    for (size_t storage = 0; storage < static_cast<size_t>(MatrixStorage::COUNT); ++storage)
+    {
+        Matrix distanceMatrix = getDistanceMatrix(depots, customers, static_cast<MatrixStorage>(storage));
+
+        std::vector<std::vector<int>> expected;
+        std::vector<char> used(customers.size() + 1, 0);
+        for (size_t step = 0; step < customers.size(); ++step)
+        {
+            if (expected.empty() || expected.back().size() == maxPackages / 2 + 1)
+            {
+                expected.push_back({0});
+            }
+            const int from = expected.back().back();
+            int nearest = -1;
+            for (int id = 1; id <= static_cast<int>(customers.size()); ++id)
+            {
+                if (!used[id] && (nearest == -1 || distanceMatrix(from, id) < distanceMatrix(from, nearest)))
+                {
+                    nearest = id;
+                }
+            }
+            used[nearest] = 1;
+            expected.back().push_back(nearest);
+        }
+        for (auto &route : expected)
+        {
+            route.push_back(0);
+        }
+
+        INFO("storage " << storage);
+        REQUIRE(createNearestNeighbourIndividual(distanceMatrix, maxPackages).routes == expected);
+    }
+}
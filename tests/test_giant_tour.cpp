@@ -0,0 +1,172 @@
+#include "giant_tour.h"
+#include "genetic_algorithm.h"
+#include "genetic_algo_utils.h"
+#include "utils.h"
+#include "rng.h"
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <omp.h>
+
+static std::vector<int> shuffledCustomers(const size_t numCustomers, std::mt19937 &gen)
+{
+    std::vector<int> tour(numCustomers);
+    std::iota(tour.begin(), tour.end(), 1);
+    std::shuffle(tour.begin(), tour.end(), gen);
+    return tour;
+}
+
+/* Fuzz test checks that splitTour:
+    1. Finds the same total distance as trying every route length for every prefix of the tour.
+    2. Returns routes that keep the order of the tour, hold at most maxPackages customers and add up to that distance.
+*/
+TEST_CASE("Fuzz test that splitTour finds the best split", "[splitTour]")
+{
+    static std::random_device rd;
+    static std::mt19937 gen(rd());
+    std::uniform_int_distribution<size_t> customerDist(1, 120);
+    std::uniform_int_distribution<size_t> maxPackagesDist(1, 12);
+
+    for (size_t round = 0; round < 100; ++round)
+    {
+        const size_t numCustomers = customerDist(gen);
+        const size_t maxPackages = maxPackagesDist(gen);
+        Matrix distanceMatrix = getDistanceMatrix(getRandomPoints(1, 100.0, 500.0, gen()), getRandomPoints(numCustomers, 100.0, 500.0, gen()));
+        std::vector<int> tour = shuffledCustomers(numCustomers, gen);
+
+        std::vector<double> best(numCustomers + 1, std::numeric_limits<double>::infinity());
+        best[0] = 0.0;
+        for (size_t j = 1; j <= numCustomers; ++j)
+        {
+            for (size_t i = j - std::min(j, maxPackages); i < j; ++i)
+            {
+                std::vector<int> route = {0};
+                route.insert(route.end(), tour.begin() + i, tour.begin() + j);
+                route.push_back(0);
+                best[j] = std::min(best[j], best[i] + routeDistance(route, distanceMatrix));
+            }
+        }
+
+        std::vector<std::vector<int>> routes;
+        const double distance = splitTour(tour.data(), numCustomers, maxPackages, distanceMatrix, routes);
+        REQUIRE(std::abs(distance - best[numCustomers]) <= best[numCustomers] * 1e-9);
+        REQUIRE(splitTour(tour.data(), numCustomers, maxPackages, distanceMatrix) == distance);
+        REQUIRE(std::abs(distanceOfRoutes(routes, distanceMatrix) - distance) <= distance * 1e-9);
+
+        std::vector<int> joined(numCustomers);
+        giantTour(routes, joined.data());
+        REQUIRE(joined == tour);
+        for (const auto &route : routes)
+        {
+            REQUIRE(route.front() == 0);
+            REQUIRE(route.back() == 0);
+            REQUIRE(route.size() >= 3);
+            REQUIRE(route.size() <= maxPackages + 2);
+        }
+    }
+}
+
+TEST_CASE("orderCrossover keeps a slice of the first parent and the order of the second", "[orderCrossover]")
+{
+    std::mt19937 gen(5);
+    Rng rng(5);
+    for (size_t numCustomers : {1, 2, 7, 50})
+    {
+        for (int round = 0; round < 20; ++round)
+        {
+            std::vector<int> parentA = shuffledCustomers(numCustomers, gen);
+            std::vector<int> parentB = shuffledCustomers(numCustomers, gen);
+            std::vector<int> child(numCustomers, 0);
+            orderCrossover(parentA.data(), parentB.data(), numCustomers, child.data(), rng);
+
+            std::vector<int> sorted = child;
+            std::sort(sorted.begin(), sorted.end());
+            std::vector<int> expected(numCustomers);
+            std::iota(expected.begin(), expected.end(), 1);
+            REQUIRE(sorted == expected);
+
+            // The customers that do not sit where they are in parentA come in the order of parentB, from some start on
+            std::vector<int> fromB;
+            for (size_t k = 0; k < numCustomers; ++k)
+            {
+                if (child[k] != parentA[k])
+                {
+                    fromB.push_back(child[k]);
+                }
+            }
+            std::vector<int> orderInB;
+            for (int customer : parentB)
+            {
+                if (std::find(fromB.begin(), fromB.end(), customer) != fromB.end())
+                {
+                    orderInB.push_back(customer);
+                }
+            }
+            bool isRotation = fromB.empty();
+            for (size_t shift = 0; shift < fromB.size() && !isRotation; ++shift)
+            {
+                std::rotate(fromB.begin(), fromB.begin() + 1, fromB.end());
+                isRotation = fromB == orderInB;
+            }
+            REQUIRE(isRotation);
+        }
+    }
+}
+
+/* Checks geneticSolver with the giant tour representation:
+    1. Every customer is in the final routes exactly once and no route is longer than maxPackages, with and without islands.
+    2. The routes for a seed do not depend on the number of threads.
+    3. The best distance is never worse than the Clarke-Wright start.
+*/
+TEST_CASE("geneticSolver with giant tours returns a proper solution", "[geneticSolver]")
+{
+    const size_t numCustomers = 90;
+    const size_t maxPackages = 8;
+    Matrix distanceMatrix = getDistanceMatrix({{550.0, 550.0}}, getRandomPoints(numCustomers, 100.0, 1000.0, 13));
+
+    for (size_t islands : {1, 3})
+    {
+        for (StartingType startingType : {StartingType::ClarkeWright, StartingType::Random, StartingType::Mixed})
+        {
+            GeneticOptions options;
+            options.representation = Representation::GiantTour;
+            options.seed = 21;
+            options.islands.count = islands;
+            options.islands.migrationInterval = 4;
+            const int defaultThreads = omp_get_max_threads();
+
+            omp_set_num_threads(1);
+            RoutesProgress oneThread = geneticSolver(distanceMatrix, maxPackages, 12, 15, 0.5f, startingType, options).progress;
+            omp_set_num_threads(3);
+            RoutesProgress threeThreads = geneticSolver(distanceMatrix, maxPackages, 12, 15, 0.5f, startingType, options).progress;
+            omp_set_num_threads(defaultThreads);
+            REQUIRE(oneThread.frames() == threeThreads.frames());
+
+            std::vector<int> count(numCustomers + 1, 0);
+            for (const auto &route : oneThread.back())
+            {
+                REQUIRE(route.front() == 0);
+                REQUIRE(route.back() == 0);
+                REQUIRE(route.size() <= maxPackages + 2);
+                for (size_t pos = 1; pos < route.size() - 1; ++pos)
+                {
+                    count[route[pos]]++;
+                }
+            }
+            for (size_t customer = 1; customer <= numCustomers; ++customer)
+            {
+                REQUIRE(count[customer] == 1);
+            }
+
+            if (startingType == StartingType::ClarkeWright)
+            {
+                const double start = createCalrkeWrightIndividual(distanceMatrix, maxPackages).total_distance;
+                REQUIRE(distanceOfRoutes(oneThread.back(), distanceMatrix) <= start * (1.0 + 1e-9));
+            }
+        }
+    }
+}
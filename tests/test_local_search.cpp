@@ -0,0 +1,182 @@
+#include "local_search.h"
+#include "genetic_algo_utils.h"
+#include "utils.h"
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+/* Fuzz test checks that:
+    1. The route still starts and ends with zero (depot).
+    2. The route still visits the same locations.
+    3. The route is never longer than before.
+    4. The returned gain matches the change in route distance.
+*/
+TEST_CASE("Fuzz test that improveRoute returns a proper route", "[improveRoute]")
+{
+    const double minDistance = 100.0;
+    const double maxDistance = 500.0;
+    const size_t numDepots = 1;
+
+    size_t fuzzRounds = 200;
+
+    size_t minCustomers = 1;
+    size_t maxCustomers = 60;
+
+    static std::random_device rd;
+    static std::mt19937 gen(rd());
+    std::uniform_int_distribution<size_t> customerDist(minCustomers, maxCustomers);
+
+    for (size_t i = 0; i < fuzzRounds; ++i)
+    {
+        const size_t numCustomers = customerDist(gen);
+
+        std::vector<Point> depots = getRandomPoints(numDepots, minDistance, maxDistance);
+        std::vector<Point> customers = getRandomPoints(numCustomers, minDistance, maxDistance);
+        Matrix distanceMatrix = getDistanceMatrix(depots, customers);
+
+        std::vector<int> route(numCustomers);
+        std::iota(route.begin(), route.end(), 1);
+        std::shuffle(route.begin(), route.end(), gen);
+        route.insert(route.begin(), 0);
+        route.push_back(0);
+        const std::vector<int> originalRoute = route;
+
+        std::vector<unsigned char> dontLook(distanceMatrix.size());
+        double before = routeDistance(route, distanceMatrix);
+        double gain = improveRoute(route, distanceMatrix, dontLook);
+        double after = routeDistance(route, distanceMatrix);
+
+        REQUIRE(route.front() == 0);
+        REQUIRE(route.back() == 0);
+
+        std::vector<int> sortedRoute = route;
+        std::vector<int> sortedOriginal = originalRoute;
+        std::sort(sortedRoute.begin(), sortedRoute.end());
+        std::sort(sortedOriginal.begin(), sortedOriginal.end());
+        REQUIRE(sortedRoute == sortedOriginal);
+
+        REQUIRE(after <= before + 1e-9);
+        REQUIRE(std::abs((before - after) - gain) < 1e-6);
+    }
+}
+
+TEST_CASE("improveRoute uncrosses a route around a square", "[improveRoute]")
+{
+    // Depot in the bottom left corner, customers at the other corners of a square, visited in a crossing order
+    std::vector<Point> depots = {{0.0, 0.0}};
+    std::vector<Point> customers = {{10.0, 0.0}, {10.0, 10.0}, {0.0, 10.0}};
+    Matrix distanceMatrix = getDistanceMatrix(depots, customers);
+
+    std::vector<int> route = {0, 2, 1, 3, 0};
+    std::vector<unsigned char> dontLook(distanceMatrix.size());
+    improveRoute(route, distanceMatrix, dontLook);
+
+    REQUIRE(std::abs(routeDistance(route, distanceMatrix) - 40.0) < 1e-9);
+}
+
+TEST_CASE("intraRouteSearch improves every route of an individual", "[intraRouteSearch]")
+{
+    std::vector<Point> depots = {{0.0, 0.0}};
+    std::vector<Point> customers = getRandomPoints(40, 100.0, 500.0);
+    Matrix distanceMatrix = getDistanceMatrix(depots, customers);
+
+    Rng rng(1);
+    std::vector<std::vector<int>> routes = getRandomRoutes(distanceMatrix.size(), 12, rng);
+    Individual child(routes, distanceOfRoutes(routes, distanceMatrix));
+
+    intraRouteSearch(child, distanceMatrix);
+
+    REQUIRE(child.routes.size() == routes.size());
+    for (size_t i = 0; i < routes.size(); ++i)
+    {
+        REQUIRE(child.routes[i].size() == routes[i].size());
+        REQUIRE(routeDistance(child.routes[i], distanceMatrix) <= routeDistance(routes[i], distanceMatrix) + 1e-9);
+    }
+}
+
+/* Fuzz test checks that improveRoutes:
+    1. Keeps every customer exactly once, each route starting and ending with zero.
+    2. Never creates a route with more than maxPackages customers or leaves an empty route.
+    3. Never makes the routes longer and returns a gain that matches the change in distance.
+*/
+TEST_CASE("Fuzz test that improveRoutes returns proper routes", "[improveRoutes]")
+{
+    const double minDistance = 100.0;
+    const double maxDistance = 500.0;
+    const size_t numDepots = 1;
+
+    size_t fuzzRounds = 100;
+
+    size_t minCustomers = 2;
+    size_t maxCustomers = 120;
+
+    size_t minMaxPackages = 3;
+    size_t maxMaxPackages = 15;
+
+    static std::random_device rd;
+    static std::mt19937 gen(rd());
+    std::uniform_int_distribution<size_t> customerDist(minCustomers, maxCustomers);
+    std::uniform_int_distribution<size_t> maxPackagesDist(minMaxPackages, maxMaxPackages);
+
+    for (size_t i = 0; i < fuzzRounds; ++i)
+    {
+        const size_t numCustomers = customerDist(gen);
+        const size_t maxPackages = maxPackagesDist(gen);
+
+        std::vector<Point> depots = getRandomPoints(numDepots, minDistance, maxDistance);
+        std::vector<Point> customers = getRandomPoints(numCustomers, minDistance, maxDistance);
+        Matrix distanceMatrix = getDistanceMatrix(depots, customers);
+
+        Rng rng(gen());
+        std::vector<std::vector<int>> routes = getRandomRoutes(distanceMatrix.size(), maxPackages, rng);
+        std::vector<unsigned char> dontLook(distanceMatrix.size());
+        double before = distanceOfRoutes(routes, distanceMatrix);
+        double gain = improveRoutes(routes, distanceMatrix, maxPackages, dontLook);
+        double after = distanceOfRoutes(routes, distanceMatrix);
+
+        std::vector<int> count(numCustomers + 1, 0);
+        for (const auto &route : routes)
+        {
+            REQUIRE(route.front() == 0);
+            REQUIRE(route.back() == 0);
+            REQUIRE(route.size() > 2);
+            REQUIRE(route.size() <= maxPackages + 2);
+            for (const auto customer : route)
+            {
+                count[customer]++;
+            }
+        }
+        REQUIRE(count[0] == routes.size() * 2);
+        for (size_t customer = 1; customer <= numCustomers; ++customer)
+        {
+            REQUIRE(count[customer] == 1);
+        }
+
+        REQUIRE(after <= before + 1e-9);
+        REQUIRE(std::abs((before - after) - gain) < 1e-6);
+    }
+}
+
+TEST_CASE("improveRoutes moves a customer to the route it is next to", "[improveRoutes]")
+{
+    // Two clusters on either side of the depot, with customer 3 starting in the wrong route
+    std::vector<Point> depots = {{0.0, 0.0}};
+    std::vector<Point> customers = {{-10.0, 1.0}, {-10.0, -1.0}, {10.0, 1.0}, {10.0, -1.0}};
+    Matrix distanceMatrix = getDistanceMatrix(depots, customers);
+
+    std::vector<std::vector<int>> routes = {{0, 1, 3, 2, 0}, {0, 4, 0}};
+    std::vector<unsigned char> dontLook(distanceMatrix.size());
+    improveRoutes(routes, distanceMatrix, 4, dontLook);
+
+    REQUIRE(routes.size() == 2);
+    for (const auto &route : routes)
+    {
+        bool west = route[1] <= 2;
+        for (size_t pos = 1; pos < route.size() - 1; ++pos)
+        {
+            REQUIRE((route[pos] <= 2) == west);
+        }
+    }
+}
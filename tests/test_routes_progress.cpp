@@ -0,0 +1,90 @@
+#include "routes_progress.h"
+#include <catch2/catch_test_macros.hpp>
+#include <vector>
+#include <stdexcept>
+
+TEST_CASE("RoutesProgress replays events and keyframes", "[RoutesProgress]")
+{
+    RoutesProgress progress;
+    progress.newRoute(1, 2);
+    progress.newRoute(3);
+    progress.addToBack(1, 4);
+    progress.addToFront(0, 5);
+    progress.join(0, 1, false, true);
+    progress.keyframe({{0, 6, 0}, {0, 2, 1, 0}});
+    progress.newRoute(7);
+    progress.join(1, 2, true, false);
+
+    std::vector<std::vector<std::vector<int>>> expectedFrames = {
+        {{0, 1, 2, 0}},
+        {{0, 1, 2, 0}, {0, 3, 0}},
+        {{0, 1, 2, 0}, {0, 3, 4, 0}},
+        {{0, 5, 1, 2, 0}, {0, 3, 4, 0}},
+        {{0, 5, 1, 2, 4, 3, 0}},
+        {{0, 6, 0}, {0, 2, 1, 0}},
+        {{0, 6, 0}, {0, 2, 1, 0}, {0, 7, 0}},
+        {{0, 6, 0}, {0, 7, 2, 1, 0}}};
+
+    REQUIRE(progress.size() == expectedFrames.size());
+    REQUIRE(progress.frames() == expectedFrames);
+    REQUIRE(progress.back() == expectedFrames.back());
+
+    // Seeking backwards and forwards across the keyframe gives the same frames as replaying from the start
+    ProgressCursor cursor(progress);
+    for (size_t index : {7, 2, 5, 6, 0, 4, 4, 3})
+    {
+        cursor.seek(index);
+        REQUIRE(cursor.routes() == expectedFrames[index]);
+        REQUIRE(progress.frame(index) == expectedFrames[index]);
+    }
+    REQUIRE_THROWS_AS(progress.frame(expectedFrames.size()), std::out_of_range);
+
+    // Flat frames hold the same routes, any range of them
+    for (size_t first = 0; first <= expectedFrames.size(); ++first)
+    {
+        for (size_t last = first; last <= expectedFrames.size(); ++last)
+        {
+            FlatFrames flat = progress.flatFrames(first, last);
+            REQUIRE(flat.frameOffsets.size() == last - first + 1);
+            for (size_t frame = 0; frame < last - first; ++frame)
+            {
+                std::vector<std::vector<int>> routes;
+                for (size_t route = flat.frameOffsets[frame]; route < flat.frameOffsets[frame + 1]; ++route)
+                {
+                    routes.emplace_back(flat.customers.begin() + flat.routeOffsets[route], flat.customers.begin() + flat.routeOffsets[route + 1]);
+                }
+                REQUIRE(routes == expectedFrames[first + frame]);
+            }
+            REQUIRE(flat.routeOffsets.back() == flat.customers.size());
+        }
+    }
+    REQUIRE(progress.flatFrames().frameOffsets.size() == expectedFrames.size() + 1);
+    REQUIRE_THROWS_AS(progress.flatFrames(0, expectedFrames.size() + 1), std::out_of_range);
+
+    // Renumbering changes the customers of every frame and keeps the depot
+    const std::vector<int> ids = {0, 7, 6, 5, 4, 3, 2, 1};
+    progress.renumber(ids);
+    for (auto &frame : expectedFrames)
+    {
+        for (auto &route : frame)
+        {
+            for (int &customer : route)
+            {
+                customer = ids[customer];
+            }
+        }
+    }
+    REQUIRE(progress.frames() == expectedFrames);
+}
+
+TEST_CASE("RoutesProgress without history keeps only the last keyframe", "[RoutesProgress]")
+{
+    RoutesProgress progress(false);
+    progress.newRoute(1, 2);
+    progress.keyframe({{0, 1, 2, 0}});
+    progress.addToBack(0, 3);
+    progress.keyframe({{0, 3, 0}, {0, 2, 1, 0}});
+
+    REQUIRE(progress.size() == 1);
+    REQUIRE(progress.frames() == std::vector<std::vector<std::vector<int>>>{{{0, 3, 0}, {0, 2, 1, 0}}});
+}
@@ -0,0 +1,154 @@
+#include "spatial_index.h"
+#include "utils.h"
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+
+/* Fuzz test checks that the k-d tree neighbour lists match a brute force search of the distance matrix:
+    1. Each customer gets min(numNeighbours, numCustomers - 1) neighbours, never itself or the depot.
+    2. The neighbours are ordered from nearest to furthest.
+    3. No customer outside the list is closer than the furthest one in it.
+*/
+TEST_CASE("Fuzz test that getNeighbourLists finds the nearest customers", "[getNeighbourLists]")
+{
+    const double minDistance = 100.0;
+    const double maxDistance = 500.0;
+    const size_t numDepots = 1;
+
+    size_t fuzzRounds = 50;
+
+    size_t minCustomers = 2;
+    size_t maxCustomers = 300;
+
+    size_t minNeighbours = 1;
+    size_t maxNeighbours = 30;
+
+    static std::random_device rd;
+    static std::mt19937 gen(rd());
+    std::uniform_int_distribution<size_t> customerDist(minCustomers, maxCustomers);
+    std::uniform_int_distribution<size_t> neighboursDist(minNeighbours, maxNeighbours);
+
+    for (size_t round = 0; round < fuzzRounds; ++round)
+    {
+        const size_t numCustomers = customerDist(gen);
+        const size_t numNeighbours = neighboursDist(gen);
+
+        std::vector<Point> depots = getRandomPoints(numDepots, minDistance, maxDistance);
+        std::vector<Point> customers = getRandomPoints(numCustomers, minDistance, maxDistance);
+        Matrix distanceMatrix = getDistanceMatrix(depots, customers);
+
+        const size_t k = std::min(numNeighbours, numCustomers - 1);
+        std::vector<int> neighbours = getNeighbourLists(distanceMatrix, numNeighbours);
+        REQUIRE(neighbours.size() == numCustomers * k);
+
+        for (int i = 1; i <= numCustomers; ++i)
+        {
+            std::vector<int> list(neighbours.begin() + (i - 1) * k, neighbours.begin() + i * k);
+            for (size_t n = 0; n < k; ++n)
+            {
+                REQUIRE(list[n] >= 1);
+                REQUIRE(list[n] <= numCustomers);
+                REQUIRE(list[n] != i);
+                if (n > 0)
+                {
+                    REQUIRE(distanceMatrix(i, list[n - 1]) <= distanceMatrix(i, list[n]));
+                }
+            }
+
+            if (k == 0)
+            {
+                continue;
+            }
+            const double furthest = distanceMatrix(i, list.back());
+            for (int j = 1; j <= numCustomers; ++j)
+            {
+                if (j != i && std::find(list.begin(), list.end(), j) == list.end())
+                {
+                    REQUIRE(distanceMatrix(i, j) >= furthest);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("getNeighbourLists falls back to the matrix rows when locations are unknown", "[getNeighbourLists]")
+{
+    std::vector<Point> depots = getRandomPoints(1, 100.0, 500.0);
+    std::vector<Point> customers = getRandomPoints(60, 100.0, 500.0);
+    Matrix distanceMatrix = getDistanceMatrix(depots, customers);
+
+    std::vector<int> fromTree = getNeighbourLists(distanceMatrix, 8);
+    distanceMatrix.locations.clear();
+    std::vector<int> fromRows = getNeighbourLists(distanceMatrix, 8);
+
+    REQUIRE(fromTree == fromRows);
+}
+
+// On a grid whose lines fall into separate cells of the curve, a Hilbert curve only ever moves to a neighbouring cell.
+TEST_CASE("hilbertOrder visits a grid one neighbour at a time", "[hilbertOrder]")
+{
+    std::vector<Point> points;
+    for (int x = 0; x < 8; ++x)
+    {
+        for (int y = 0; y < 8; ++y)
+        {
+            points.push_back({100.0 + 10.0 * x, 200.0 + 10.0 * y});
+        }
+    }
+    std::mt19937 gen(3);
+    std::shuffle(points.begin(), points.end(), gen);
+
+    std::vector<int> order = hilbertOrder(points);
+    std::vector<int> sorted = order;
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<int> expected(points.size());
+    std::iota(expected.begin(), expected.end(), 0);
+    REQUIRE(sorted == expected);
+
+    for (size_t i = 1; i < order.size(); ++i)
+    {
+        const Point &a = points[order[i - 1]];
+        const Point &b = points[order[i]];
+        REQUIRE(std::abs(a.x - b.x) + std::abs(a.y - b.y) == 10.0);
+    }
+}
+
+// Takes out the nearest customer to random locations until none is left, checking each against a scan of the matrix.
+TEST_CASE("RemovableKdTree finds the nearest customer left as customers are removed", "[RemovableKdTree]")
+{
+    std::vector<Point> depots = getRandomPoints(1, 100.0, 500.0, 7);
+    std::vector<Point> customers = getRandomPoints(300, 100.0, 500.0, 8);
+    // Repeated locations check that ties go to the lowest id
+    customers[10] = customers[20];
+    customers[40] = customers[20];
+    Matrix distanceMatrix = getDistanceMatrix(depots, customers);
+
+    std::vector<int> ids(customers.size());
+    std::iota(ids.begin(), ids.end(), 1);
+    RemovableKdTree tree(buildKdTree(customers, ids));
+    std::vector<char> removed(customers.size() + 1, 0);
+
+    std::mt19937 gen(9);
+    std::uniform_int_distribution<int> fromDist(0, static_cast<int>(customers.size()));
+    for (size_t step = 0; step < customers.size(); ++step)
+    {
+        REQUIRE_FALSE(tree.empty());
+        const int from = fromDist(gen);
+        int expected = -1;
+        for (int id = 1; id <= static_cast<int>(customers.size()); ++id)
+        {
+            if (!removed[id] && (expected == -1 || distanceMatrix(from, id) < distanceMatrix(from, expected)))
+            {
+                expected = id;
+            }
+        }
+        const int nearest = tree.nearest(distanceMatrix, from);
+        REQUIRE(nearest == expected);
+        tree.remove(nearest);
+        removed[nearest] = 1;
+    }
+    REQUIRE(tree.empty());
+    REQUIRE(tree.nearest(distanceMatrix, 0) == -1);
+}
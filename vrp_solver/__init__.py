@@ -1,2 +1,3 @@
 from ._vrp_core import * 
 from .visualize import get_locations, get_routes, plot_routes_animation
+from .jobs import wait_job
@@ -0,0 +1,21 @@
+import asyncio
+
+
+async def wait_job(job, poll_interval=0.05, timeout=None):
+    """Awaits a SolveJob without blocking the event loop and returns its result.
+
+    The job is cancelled if the timeout (in seconds) runs out or the awaiting task is cancelled,
+    in both cases the solver stops after its current generation and the result has StopReason.Cancelled.
+    """
+    loop = asyncio.get_running_loop()
+    deadline = None if timeout is None else loop.time() + timeout
+    try:
+        while not job.done():
+            if deadline is not None and loop.time() >= deadline:
+                job.cancel()
+                break
+            await asyncio.sleep(poll_interval)
+    except asyncio.CancelledError:
+        job.cancel()
+        raise
+    return await loop.run_in_executor(None, job.result)